@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# pomointer - .pf file interpreter
+# Copyright (c) 2026 José Isac Araujo Monção
+#
+# See LICENSE file for full BSD 3-Clause license terms.
+#
+# Writes a synthetic corpus of pomofiles to DIR: FILES files spread over
+# DAYS days from 01/01/2000. Every file includes config.pf, which includes
+# common.pf with the abbreviations of SUBJECTS subjects. Subjects and stars
+# per line are skewed towards a few popular ones, more as SKEW grows (1 is
+# uniform). DIR/meta gets the number of files and lines.
+#
+# Usage: bench/gen_corpus.sh DIR FILES [SUBJECTS] [DAYS] [SKEW] [SEED]
+
+if [ $# -lt 2 ]; then
+  echo "Usage: $0 DIR FILES [SUBJECTS] [DAYS] [SKEW] [SEED]" >&2
+  exit 1
+fi
+
+DIR=$1
+FILES=$2
+SUBJECTS=${3:-200}
+DAYS=${4:-$FILES}
+SKEW=${5:-2}
+SEED=${6:-1}
+
+mkdir -p "$DIR" || exit 1
+
+awk -v dir="$DIR" -v files="$FILES" -v subjects="$SUBJECTS" -v days="$DAYS" \
+    -v skew="$SKEW" -v seed="$SEED" '
+# Inverse of days_from_civil() in util.c
+function civil(z,    era, doe, yoe, doy, mp, d, m, y) {
+  z += 719468
+  era = int((z >= 0 ? z : z - 146096) / 146097)
+  doe = z - era * 146097
+  yoe = int((doe - int(doe / 1460) + int(doe / 36524) - int(doe / 146096)) / 365)
+  y = yoe + era * 400
+  doy = doe - (365 * yoe + int(yoe / 4) - int(yoe / 100))
+  mp = int((5 * doy + 2) / 153)
+  d = doy - int((153 * mp + 2) / 5) + 1
+  m = mp < 10 ? mp + 3 : mp - 9
+  return sprintf("%02d/%02d/%04d", d, m, y + (m <= 2))
+}
+
+function skewed(n) {
+  return int(n * rand() ^ skew)
+}
+
+BEGIN {
+  srand(seed)
+  first_day = 10957 # 01/01/2000
+
+  common = dir "/common.pf"
+  for (s = 0; s < subjects; s++) {
+    printf "s%d = Subject %d\n", s, s > common
+  }
+  close(common)
+
+  config = dir "/config.pf"
+  printf "#include \"common.pf\"\n\nPOMO = 25\n" > config
+  close(config)
+
+  lines = 0
+  for (f = 0; f < files; f++) {
+    file = sprintf("%s/f%07d.pf", dir, f)
+    printf "#include \"config.pf\"\n\nDATE = %s\n", civil(first_day + f % days) > file
+    lines += 3
+
+    if (f % 10 == 0) {
+      printf "POMO = %d\n", 20 + f % 4 * 10 > file
+      lines++
+    }
+    printf "\n" > file
+    lines++
+
+    count = 4 + int(rand() * 9)
+    for (l = 0; l < count; l++) {
+      s = skewed(subjects)
+      stars = substr("****************", 1, 1 + skewed(16))
+      if (rand() < 0.5) {
+        printf "s%d: %s\n", s, stars > file
+      } else {
+        printf "Subject %d: %s\n", s, stars > file
+      }
+    }
+    lines += count
+    close(file)
+  }
+
+  meta = dir "/meta"
+  printf "files %d\nlines %d\n", files, lines > meta
+  close(meta)
+}'
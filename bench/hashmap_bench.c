@@ -0,0 +1,102 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ *
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hashmap.h"
+
+// Times the HashMap with "subject-N" keys, from 10^3 to 10^7 of them, or
+// up to the count given as argument. Prints nanoseconds per operation for
+// put (into a map that grows from 16 slots), get, a whole hashmap_foreach()
+// and one hashmap_resize() of the full map, per entry. Small maps are
+// rebuilt several times so every row covers about 10^7 operations. Keys are
+// put and looked up in a shuffled order: in counting order their djb2 or
+// FNV hashes are close, which favours maps that keep neighbours together.
+
+#define KEY_SIZE 32
+#define OPERATIONS 10000000L
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void count_entry(const char* key, void* value, void* user_data) {
+  (void)key;
+  *(long*)user_data += (long)(size_t)value;
+}
+
+int main(int argc, char** argv) {
+  long max_keys = argc > 1 ? atol(argv[1]) : 10000000L;
+
+  char* keys = malloc((size_t)max_keys * KEY_SIZE);
+  if (!keys) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  unsigned long long seed = 88172645463325252ULL;
+  for (long i = 0; i < max_keys; i++) {
+    // Fisher-Yates over the key numbers, xorshift64 as generator
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    long j = (long)(seed % (unsigned long long)(i + 1));
+    if (j != i) memcpy(keys + i * KEY_SIZE, keys + j * KEY_SIZE, KEY_SIZE);
+    snprintf(keys + j * KEY_SIZE, KEY_SIZE, "subject-%ld", i);
+  }
+
+  printf("%10s %8s %8s %8s %8s\n", "keys", "put", "get", "iterate", "resize");
+
+  for (long n = 1000; n <= max_keys; n *= 10) {
+    long rounds = n < OPERATIONS ? OPERATIONS / n : 1;
+    double put = 0, get = 0, iterate = 0, resize = 0;
+    long sum = 0;
+
+    for (long r = 0; r < rounds; r++) {
+      HashMap* map = hashmap_create(16, 0.75);
+      if (!map) {
+        perror("hashmap_create");
+        return EXIT_FAILURE;
+      }
+
+      double start = now();
+      for (long i = 0; i < n; i++) {
+        hashmap_put(map, keys + i * KEY_SIZE, (void*)(size_t)(i + 1));
+      }
+      put += now() - start;
+
+      start = now();
+      for (long i = 0; i < n; i++) {
+        sum += (long)(size_t)hashmap_get(map, keys + i * KEY_SIZE);
+      }
+      get += now() - start;
+
+      start = now();
+      hashmap_foreach(map, count_entry, &sum);
+      iterate += now() - start;
+
+      start = now();
+      hashmap_resize(map);
+      resize += now() - start;
+
+      hashmap_destroy(map, NULL);
+    }
+
+    double ops = (double)n * rounds / 1e9;
+    printf("%10ld %8.1f %8.1f %8.1f %8.1f\n", n,
+           put / ops, get / ops, iterate / ops, resize / ops);
+
+    // Keeps the lookups from being optimized away
+    if (sum == 0) fprintf(stderr, "no entries\n");
+  }
+
+  free(keys);
+  return EXIT_SUCCESS;
+}
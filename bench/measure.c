@@ -0,0 +1,58 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Runs a command with its output sent to /dev/null, then prints the wall
+// time in seconds and the peak RSS in KiB. Fails if the command does.
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: measure COMMAND [ARGS...]\n");
+    return EXIT_FAILURE;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return EXIT_FAILURE;
+  }
+
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+      dup2(null, STDOUT_FILENO);
+      close(null);
+    }
+    execvp(argv[1], argv + 1);
+    perror(argv[1]);
+    _exit(127);
+  }
+
+  int status;
+  if (waitpid(pid, &status, 0) < 0) {
+    perror("waitpid");
+    return EXIT_FAILURE;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  struct rusage usage;
+  getrusage(RUSAGE_CHILDREN, &usage);
+
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("%.3f %ld\n", seconds, usage.ru_maxrss);
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# pomointer - .pf file interpreter
+# Copyright (c) 2026 José Isac Araujo Monção
+#
+# See LICENSE file for full BSD 3-Clause license terms.
+#
+# Times rendering a report of 1M rows (1000 days of 1000 subjects), as text
+# and as html, written to /dev/null.
+#
+# Usage: bench/render.sh [pomointer binary] [runs]
+
+BIN=${1:-build/pomointer}
+RUNS=${2:-3}
+DIR=${TMPDIR:-/tmp}/pomointer-render-bench
+
+if [ ! -x "$BIN" ]; then
+  echo "Error: cannot execute '$BIN', run make first" >&2
+  exit 1
+fi
+
+if [ ! -f "$DIR/d0999.pf" ]; then
+  mkdir -p "$DIR"
+  awk -v dir="$DIR" 'BEGIN {
+    for (f = 0; f < 1000; f++) {
+      file = sprintf("%s/d%04d.pf", dir, f)
+      printf "POMO = 25\nDATE = %02d/%02d/%d\n\n", f % 28 + 1, int(f / 28) % 12 + 1, 2000 + int(f / 336) > file
+      for (s = 0; s < 1000; s++) {
+        printf "Subject%04d: %s\n", s, substr("****************", 1, (s * 7 + f) % 16 + 1) > file
+      }
+      close(file)
+    }
+  }'
+fi
+
+# Best of RUNS, in seconds
+best() {
+  best_time=
+  i=0
+  while [ $i -lt "$RUNS" ]; do
+    start=$(date +%s.%N)
+    "$BIN" "$@" "$DIR"/*.pf > /dev/null
+    end=$(date +%s.%N)
+    best_time=$(echo "$start $end $best_time" | awk '{ t = $2 - $1; if ($3 != "" && $3 < t) t = $3; printf "%.3f", t }')
+    i=$((i + 1))
+  done
+  echo "$best_time"
+}
+
+echo "text: $(best)s"
+echo "html: $(best -e html)s"
@@ -0,0 +1,90 @@
+#!/bin/sh
+#
+# pomointer - .pf file interpreter
+# Copyright (c) 2026 José Isac Araujo Monção
+#
+# See LICENSE file for full BSD 3-Clause license terms.
+#
+# Times the whole pipeline over generated corpora of growing size and
+# writes the results as TSV. When a baseline exists, each size is compared
+# with it and the ones slower by more than BENCH_TOLERANCE percent are
+# reported as regressions, making the script fail.
+#
+# Environment:
+#   BENCH_SIZES      Corpus sizes in files (100 1000 10000 100000),
+#                    1000000 works too but takes a while to generate
+#   BENCH_RUNS       Runs per size, the fastest is kept (3)
+#   BENCH_ARGS       Extra pomointer options, like "-j 4"
+#   BENCH_DIR        Where corpora are generated and kept between runs
+#   BENCH_RESULTS    Results file (build/bench.tsv)
+#   BENCH_BASELINE   Baseline to compare with (bench/baseline.tsv)
+#   BENCH_TOLERANCE  Slowdown allowed, in percent (10)
+
+BIN=$(pwd)/build/pomointer
+MEASURE=$(pwd)/build/measure
+GEN=$(pwd)/bench/gen_corpus.sh
+SIZES=${BENCH_SIZES:-"100 1000 10000 100000"}
+RUNS=${BENCH_RUNS:-3}
+DIR=${BENCH_DIR:-${TMPDIR:-/tmp}/pomointer-bench}
+RESULTS=${BENCH_RESULTS:-build/bench.tsv}
+BASELINE=${BENCH_BASELINE:-bench/baseline.tsv}
+TOLERANCE=${BENCH_TOLERANCE:-10}
+
+for program in "$BIN" "$MEASURE"; do
+  if [ ! -x "$program" ]; then
+    echo "Error: cannot execute '$program', run make bench" >&2
+    exit 1
+  fi
+done
+
+printf "size\tseconds\tfiles_per_sec\tlines_per_sec\tmax_rss_kb\n" > "$RESULTS"
+
+for size in $SIZES; do
+  corpus=$DIR/$size
+  if [ ! -f "$corpus/meta" ]; then
+    echo "Generating $size files in $corpus" >&2
+    days=$size
+    [ "$days" -gt 3650 ] && days=3650
+    "$GEN" "$corpus" "$size" 200 "$days" || exit 1
+  fi
+  lines=$(awk '$1 == "lines" { print $2 }' "$corpus/meta")
+
+  best=
+  i=0
+  while [ $i -lt "$RUNS" ]; do
+    # Passing the directory keeps any size under the argument limit
+    # shellcheck disable=SC2086
+    run=$(cd "$corpus" && "$MEASURE" "$BIN" $BENCH_ARGS .) || {
+      echo "Error: run over $size files failed" >&2
+      exit 1
+    }
+    best=$(echo "$run $best" | awk '{ if ($3 != "" && $3 <= $1) print $3, $4; else print $1, $2 }')
+    i=$((i + 1))
+  done
+
+  echo "$size $best $lines" | awk '{
+    seconds = $2 > 0 ? $2 : 0.001
+    printf "%d\t%.3f\t%.0f\t%.0f\t%d\n", $1, $2, $1 / seconds, $4 / seconds, $3
+  }' >> "$RESULTS"
+done
+
+column -t "$RESULTS" 2> /dev/null || cat "$RESULTS"
+
+if [ ! -f "$BASELINE" ]; then
+  echo "No baseline at $BASELINE, make bench-baseline stores one" >&2
+  exit 0
+fi
+
+echo
+awk -v tolerance="$TOLERANCE" '
+  FNR == 1 { next }
+  NR == FNR { baseline[$1] = $2; next }
+  !($1 in baseline) { next }
+  {
+    change = baseline[$1] > 0 ? ($2 - baseline[$1]) / baseline[$1] * 100 : 0
+    status = change > tolerance ? "REGRESSION" : "ok"
+    printf "%8d files: %.3fs -> %.3fs (%+.1f%%) %s\n", $1, baseline[$1], $2, change, status
+    if (status != "ok") failed = 1
+  }
+  END { exit failed }
+' "$BASELINE" "$RESULTS"
@@ -0,0 +1,26 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_ARENA_H
+#define POMOINTER_ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator. Everything allocated from it is released at once by
+// arena_free(). Not thread safe, each thread should use its own.
+typedef struct {
+  ArenaBlock* blocks; // Current block first
+  size_t block_size;
+} Arena;
+
+void arena_init(Arena* arena, size_t block_size);
+void* arena_alloc(Arena* arena, size_t size);
+char* arena_strndup(Arena* arena, const char* str, size_t len);
+void arena_free(Arena* arena);
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_DAY_INDEX_H
+#define POMOINTER_DAY_INDEX_H
+
+#include <stdbool.h>
+#include "registers.h"
+
+typedef struct {
+  int day;                 // Days since 01/01/1970
+  char* date;              // "dd/mm/yyyy" key in global registers
+  RegisterMap* registers;
+} DayEntry;
+
+// Dates of the global registers, sorted by day number on demand
+typedef struct {
+  DayEntry* days;
+  int size;
+  int capacity;
+  bool sorted;
+} DayIndex;
+
+void day_index_init(DayIndex* index);
+int day_index_add(DayIndex* index, int day, char* date, RegisterMap* registers);
+void day_index_sort(DayIndex* index);
+int day_index_lower_bound(DayIndex* index, int day);
+void day_index_free(DayIndex* index);
+
+#endif
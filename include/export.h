@@ -7,10 +7,29 @@
 #ifndef POMOINTER_EXPORT_HTML_H
 #define POMOINTER_EXPORT_HTML_H
 
-void print_html_top_part(void); 
-void print_table_top_part(const char* date, char* pomodoro_duration);
-void print_table_down_part(void);
-void print_html_down_part(void); 
- 
+// Output format of the report. Rows are written as they come, through the
+// output buffer, so no format keeps the report in memory.
+typedef struct {
+  const char* name;
+  void (*begin)(void);
+  void (*begin_date)(const char* date, int pomodoro_duration);
+  void (*row)(const char* date, const char* subject, int pomodoros, long long minutes);
+  void (*end_date)(void);
+  void (*end)(void);
+
+  // --summary, written instead of everything above
+  void (*begin_summary)(void);
+  void (*summary_row)(const char* subject, long long pomodoros, long long minutes);
+  void (*end_summary)(void);
+
+  // --by, written instead of everything above
+  void (*begin_periods)(void);
+  void (*begin_period)(const char* period);
+  void (*period_row)(const char* period, const char* subject, long long pomodoros, long long minutes);
+  void (*end_period)(void);
+  void (*end_periods)(void);
+} Exporter;
+
+const Exporter* exporter_find(const char* name);
+
 #endif
- 
@@ -7,33 +7,49 @@
 #ifndef POMOINTER_HASHMAP_H
 #define POMOINTER_HASHMAP_H
 
-// Key-value structure
+#include <stddef.h>
+
+// Key-value slot, empty when key is NULL. Kept at 24 bytes: lookups and
+// iteration walk the slots, so the smaller they are the fewer cache lines
+// a probe or a whole pass touches.
 typedef struct Entry {
   char* key;
   void* value;
-  struct Entry* next;
+  unsigned int hash;      // Cached hash of key
+  unsigned int length;    // Length of key, longer keys are refused
 } Entry;
 
-// Main HashMap structure
+// Storage for the keys of a map, freed all at once
+typedef struct KeyChunk {
+  struct KeyChunk* next;
+  size_t used;
+  size_t size;
+  char data[];
+} KeyChunk;
+
+// Main HashMap structure(open addressing, Robin Hood probing)
 typedef struct HashMap {
-  Entry** buckets;        // Buckets array(linked list)
-  int capacity;           // Buckets array size 
+  Entry* buckets;         // Slots array
+  int capacity;           // Slots array size, always a power of two
   int size;               // Actual number of elements
   float load_factor;      // Load factor for resizing
+  KeyChunk* keys;         // Where the keys are copied to
 } HashMap;
 
 // Iterator structure
 typedef struct {
   HashMap* map;
-  int bucket_index;
+  int bucket_index;       // Next slot to look at
   Entry* current_entry;
 } HashMapIterator;
 
 
 HashMap* hashmap_create(int initial_capacity, float load_factor);
-void hashmap_resize(HashMap* map);
-void hashmap_put(HashMap* map, const char* key, void* value);
+int hashmap_resize(HashMap* map);
+int hashmap_put(HashMap* map, const char* key, void* value);
+int hashmap_put_len(HashMap* map, const char* key, size_t len, void* value);
 void* hashmap_get(HashMap* map, const char* key);
+void* hashmap_get_len(HashMap* map, const char* key, size_t len);
 int hashmap_remove(HashMap* map, const char* key, void (*free_value)(void*));
 int hashmap_contains(HashMap* map, const char* key);
 int hashmap_size(HashMap* map);
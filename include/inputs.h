@@ -0,0 +1,50 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_INPUTS_H
+#define POMOINTER_INPUTS_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include "pomofile.h"
+
+// Where an input comes from, which orders it before the others
+#define INPUT_NAMED 0              // Named on the command line
+#define INPUT_FOUND(dir) (1 + (dir)) // Found walking its dir-th directory
+#define INPUT_LISTED INT_MAX       // Read from a -f list
+
+// A file to process, kept at the same address for the whole run
+typedef struct {
+  const char* path;
+  PomoFile pomofile;
+  int result;    // Of pomofile_parse(), 0 until parsed or when skipped
+  int source;    // INPUT_NAMED, INPUT_FOUND() or INPUT_LISTED
+  int index;     // Position in the list
+  bool found;    // Found walking a directory, not named by the user
+  bool skipped;  // Found, but only ever included by other files
+} Input;
+
+// Inputs in the order they were added, while they are still being added.
+// Any number of producers add paths, workers claim inputs to parse and the
+// merge waits for them one at a time, in order. Each worker takes a share of
+// the new inputs into its own deque and steals half of another one's when
+// it runs dry. Thread safe.
+typedef struct InputList InputList;
+
+InputList* input_list_create(int workers);
+void input_list_open(InputList* list);
+void input_list_close(InputList* list);
+int input_list_add(InputList* list, const char* path, size_t len, int source);
+Input* input_list_claim(InputList* list, int worker);
+void input_list_parsed(InputList* list, Input* input, int result);
+Input* input_list_wait(InputList* list, int index, Input** work);
+Input* input_list_get(InputList* list, int index);
+int input_list_count(InputList* list);
+void input_list_destroy(InputList* list);
+
+int input_order(const Input* a, const Input* b);
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_MANIFEST_H
+#define POMOINTER_MANIFEST_H
+
+#include "inputs.h"
+
+// Reads a list of paths in the background, from a file or "-" for standard
+// input, adding each one to an input list as soon as it is read. Paths are
+// separated by NUL bytes, as find -print0 writes them, or by newlines.
+typedef struct Manifest Manifest;
+
+Manifest* manifest_start(InputList* list, const char* path);
+int manifest_join(Manifest* manifest);
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_OUTPUT_H
+#define POMOINTER_OUTPUT_H
+
+#include <stddef.h>
+
+// Buffered writer for everything the reports print to stdout. Nothing goes
+// out until the buffer fills or output_flush() is called, so don't mix it
+// with printf(). A thread can write somewhere else with output_redirect().
+void output_write(const char* data, size_t len);
+void output_string(const char* str);
+void output_char(char c);
+void output_int(int n);
+void output_long(long long n);
+void output_minutes(long long minutes);  // As 1h05min, 2h or 45min
+void output_tomatoes(int count);
+void output_flush(void);
+int output_redirect(int fd);
+
+#endif
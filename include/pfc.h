@@ -0,0 +1,39 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_PFC_H
+#define POMOINTER_PFC_H
+
+#include <stdbool.h>
+#include <time.h>
+#include "preprocessor.h"
+
+// On-disk cache of parsed pomofiles (.pfc). A record holds what parsing a
+// file produced, and stays valid while the file and everything it included
+// keep their mtime and size.
+typedef struct PfcCache PfcCache;
+
+typedef struct {
+  const char* subject;
+  int pomodoros;
+} PfcCount;
+
+typedef struct {
+  int date; // Day number
+  int pomodoro_duration;
+  const FileStamp* dependencies; // The file itself first
+  int dependency_count;
+  const PfcCount* counts;
+  int count_count;
+} PfcRecord;
+
+PfcCache* pfc_cache_open(const char* path);
+const PfcRecord* pfc_cache_find(PfcCache* cache, const char* path);
+void pfc_cache_put(PfcCache* cache, const PfcRecord* record);
+int pfc_cache_save(PfcCache* cache);
+void pfc_cache_close(PfcCache* cache);
+
+#endif
@@ -9,8 +9,15 @@
 
 #include <time.h>
 #include <stdbool.h>
+#include "arena.h"
 #include "hashmap.h"
+#include "preprocessor.h"
 #include "process_data.h"
+#include "registers.h"
+#include "rollup.h"
+
+// pomofile_parse() result of a file dated outside -a and -b, left unread
+#define POMOFILE_OUT_OF_RANGE 2
 
 typedef enum {
   LINE_ASSIGNMENT,
@@ -21,16 +28,31 @@ typedef enum {
 typedef struct {
   const char* path;
   HashMap* assignments;
-  HashMap* registers;
-  time_t date;
+  Arena arena; // Assignment values, released after the merge
+  HashMap* shared_assignments; // Parsed include, read only
+  RegisterMap* registers;
+  int date; // Day number
   int pomodoro_duration; // Minutes
+  FileStamp* dependencies; // Files read while parsing, kept for -c and -w
+  int dependency_count;
+  bool cached;             // Loaded from the .pfc cache instead of parsed
 } PomoFile;
 
 int pomofile_init(PomoFile* pomofile, const char* path);
 int parse_file(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data);
+int pomofile_parse(PomoFile* pomofile, ProcessData* process_data);
+void pomofile_merge(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data);
+void pomofile_unmerge(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data);
+void pomofile_set_duration(ProcessData* process_data, int day, int pomodoro_duration);
 void free_pomofile(PomoFile* pomofile);
 void print_pomofile(PomoFile* pomofile);
+IncludeCache* pomofile_create_include_cache(void);
+HashMap* pomofile_create_subject_set(char** subjects);
 void process_final_registers(const char* date, void* registers, void* process_data);
-void filter_registers(ProcessData* process_data, HashMap* filtered_registers);
+void filter_registers(ProcessData* process_data, int* first, int* end);
+void print_dates(ProcessData* process_data, int first, int end, bool reverse);
+bool has_dates_in_range(ProcessData* process_data);
+void print_summary(ProcessData* process_data, int first, int end);
+void print_periods(ProcessData* process_data, Period period, int first, int end, bool reverse);
 
 #endif
@@ -7,10 +7,49 @@
 #ifndef POMOINTER_PREPROCESSOR_H
 #define POMOINTER_PREPROCESSOR_H
 
+#include <stdbool.h>
 #include <stdio.h>
 
 #define MAX_INCLUDE_DEPTH 10
 
-FILE* preprocess_file(const char* path, int depth);
+// Reads a file line by line, expanding #include directives on the fly.
+// Keeps one mapped source per include level and hands out views of their
+// lines, nothing is copied.
+typedef struct PomoReader PomoReader;
+
+// Includes already read, keyed by resolved path, inode, mtime and size.
+// Safe to share between threads.
+typedef struct IncludeCache IncludeCache;
+
+// Builds the table of an included file from its expanded lines. Returns NULL
+// when the file can't be reduced to a table, so it is read as text.
+typedef void* (*IncludeTableParser)(PomoReader* reader);
+
+// Offered the table of an included file. Returns true when it took it and
+// the lines of the include must be skipped.
+typedef bool (*IncludeTableHook)(const void* table, void* user_data);
+
+// A file read through a reader, as it was when it was read
+typedef struct {
+  char* path;       // Resolved when possible
+  long long mtime;  // Nanoseconds
+  long long size;   // -1 if the file couldn't be found
+} FileStamp;
+
+IncludeCache* include_cache_create(IncludeTableParser parse_table, void (*free_table)(void*));
+int include_cache_revalidate(IncludeCache* cache);
+void include_cache_destroy(IncludeCache* cache);
+
+PomoReader* reader_open(const char* path, IncludeCache* cache, bool allow_map,
+                        IncludeTableHook hook, void* user_data);
+const char* reader_next_line(PomoReader* reader, size_t* length);
+const char* reader_path(PomoReader* reader);
+int reader_line_number(PomoReader* reader);
+int reader_depth(PomoReader* reader);
+int reader_dependency_count(PomoReader* reader);
+const FileStamp* reader_dependencies(PomoReader* reader);
+void reader_close(PomoReader* reader);
+
+bool file_stamp_is_current(const FileStamp* stamp);
 
 #endif
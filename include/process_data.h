@@ -9,23 +9,37 @@
 
 #include <stdbool.h>
 #include <time.h>
+#include "arena.h"
+#include "day_index.h"
+#include "export.h"
 #include "hashmap.h"
+#include "pfc.h"
+#include "preprocessor.h"
+#include "rollup.h"
 
 typedef struct {
   bool aftdate_flag;
   bool befdate_flag;
   bool subj_flag;
-  bool export_flag;
-  time_t after_date;
-  time_t before_date;
+  int after_date;  // Day numbers
+  int before_date;
   char** subjects;
-  char* export_type;
+  HashMap* subject_set; // Same subjects, looked up while parsing
 } RegisterFilter;
 
 typedef struct {
-  HashMap* pomodoro_durations;
+  HashMap* pomodoro_durations; // Date -> minutes, an intptr_t in the pointer
   HashMap* global_registers;
+  DayIndex day_index;          // Dates of global_registers
+  Rollups* rollups;            // NULL unless --by was given
+  IncludeCache* include_cache;
+  PfcCache* pfc_cache;         // NULL unless -c was given
+  bool track_dependencies;     // Keep the files each pomofile read, for -c and -w
+  bool skip_out_of_range;      // Stop reading files dated outside -a and -b
+  bool map_files;              // Map input files, not when -w or --serve reread them as they change
   RegisterFilter register_filter;
+  const Exporter* exporter;    // Picked from -e, text by default
+  Arena arena;                 // Dates and durations, kept for the whole run
 } ProcessData;
 
 #endif 
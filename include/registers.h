@@ -0,0 +1,37 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_REGISTERS_H
+#define POMOINTER_REGISTERS_H
+
+#include <stdbool.h>
+
+// Pomodoros counted for a subject, known by its interned id
+typedef struct {
+  int subject; // -1 for an empty slot
+  int pomodoros;
+  int lines;   // Register lines counted, the subject goes away at 0
+} Register;
+
+// Subject id -> pomodoros map, open addressing like HashMap
+typedef struct {
+  Register* slots;
+  int capacity; // Power of two
+  int size;
+  float load_factor;
+} RegisterMap;
+
+RegisterMap* register_map_create(int initial_capacity, float load_factor);
+int register_map_add(RegisterMap* map, int subject, int pomodoros);
+int register_map_get(RegisterMap* map, int subject);
+int register_map_merge(RegisterMap* dest, RegisterMap* src);
+int register_map_subtract(RegisterMap* dest, RegisterMap* src);
+int register_map_retain(RegisterMap* map, bool (*keep)(int, void*), void* user_data);
+int register_map_size(RegisterMap* map);
+void register_map_foreach(RegisterMap* map, void (*callback)(const char*, int, void*), void* user_data);
+void register_map_destroy(RegisterMap* map);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_ROLLUP_H
+#define POMOINTER_ROLLUP_H
+
+#include "registers.h"
+
+// Longest label of a period, "mm/yyyy" of any two ints with their signs
+#define PERIOD_STRING_SIZE 24
+
+// Periods of --by. Weeks start on Monday.
+typedef enum {
+  PERIOD_WEEK,
+  PERIOD_MONTH,
+  PERIOD_YEAR,
+  PERIOD_COUNT
+} Period;
+
+// Totals of a subject over a period
+typedef struct {
+  int subject; // -1 for an empty slot
+  int lines;   // Register lines counted, the subject isn't reported at 0
+  long long pomodoros;
+  long long minutes;
+} RollupTotal;
+
+// Subject id -> totals, open addressing like RegisterMap. Subjects are
+// never removed, only left at 0 lines.
+typedef struct {
+  RollupTotal* slots; // NULL until something is added
+  int capacity;       // Power of two
+  int size;
+} RollupTable;
+
+// Totals of every week, month and year with registers, kept up to date
+// while merging so --by doesn't add up the days again
+typedef struct {
+  RollupTable* tables[PERIOD_COUNT]; // By period number, from first
+  int first[PERIOD_COUNT];
+  int count[PERIOD_COUNT];
+} Rollups;
+
+int period_find(const char* name);
+int period_number(Period period, int day);
+int period_first_day(Period period, int number);
+char* period_to_string(Period period, int number, char* buffer);
+
+int rollup_table_add(RollupTable* table, int subject, int lines, long long pomodoros, long long minutes);
+int rollup_table_merge(RollupTable* dest, const RollupTable* src);
+void rollup_table_clear(RollupTable* table);
+void rollup_table_free(RollupTable* table);
+
+Rollups* rollups_create(void);
+int rollups_add(Rollups* rollups, int day, RegisterMap* registers, int sign, int minutes_per_pomodoro);
+const RollupTable* rollups_get(Rollups* rollups, Period period, int number);
+void rollups_destroy(Rollups* rollups);
+
+#endif
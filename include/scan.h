@@ -0,0 +1,27 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_SCAN_H
+#define POMOINTER_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// What a pomofile line is told apart by, found in a single pass. Blocks of
+// 16 bytes are compared at once on x86-64, 32 in optimized builds when the
+// CPU has AVX2, and memchr() does it elsewhere.
+typedef struct {
+  size_t equal;    // Offset of the first '=', the length when there's none
+  size_t colon;    // Offset of the first ':', the length when there's none
+  int equal_count;
+  int colon_count;
+  bool blank;      // Only whitespace
+} LineScan;
+
+void scan_line(const char* line, size_t len, LineScan* scan);
+int scan_count_stars(const char* str, size_t len);
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_SERVE_H
+#define POMOINTER_SERVE_H
+
+#include "process_data.h"
+
+// Answers queries over a Unix domain socket, from a snapshot of the merged
+// registers. Each connection sends one line with options, like
+// "-a 01/03/2026 -s Math -e json", and gets the report back. Queries run in
+// parallel and never wait for a reload: server_publish() builds a new
+// snapshot aside and swaps it in.
+typedef struct Server Server;
+
+Server* server_start(const char* path, ProcessData* process_data);
+void server_publish(Server* server, ProcessData* process_data);
+void server_stop(Server* server);
+
+#endif
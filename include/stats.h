@@ -0,0 +1,48 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_STATS_H
+#define POMOINTER_STATS_H
+
+#include <stdbool.h>
+
+// Where the time of a run goes, printed by --stats. Files are preprocessed
+// while they are parsed, so includes count as parsing time. Parsing runs on
+// every thread, its time is the sum of all of them.
+typedef enum {
+  PHASE_PARSE,
+  PHASE_MERGE,
+  PHASE_FILTER,
+  PHASE_RENDER,
+  PHASE_COUNT
+} StatsPhase;
+
+typedef struct {
+  bool enabled;
+  double seconds[PHASE_COUNT];
+  long long files;
+  long long files_out_of_range; // Left unread, see -a and -b
+  long long lines;
+  long long includes;
+  long long registers_created;  // New subjects on a date
+  long long registers_merged;
+  long long hashmap_resizes;
+  long long bytes_written;
+} Stats;
+
+extern Stats stats;
+
+// Only a test of the flag when --stats is off. Safe from any thread.
+#define STATS_ADD(counter, n) \
+  do { \
+    if (stats.enabled) __atomic_fetch_add(&stats.counter, (long long)(n), __ATOMIC_RELAXED); \
+  } while (0)
+
+double stats_start(void);
+void stats_stop(StatsPhase phase, double start);
+void stats_print(void);
+
+#endif
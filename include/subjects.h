@@ -0,0 +1,24 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_SUBJECTS_H
+#define POMOINTER_SUBJECTS_H
+
+#include <stddef.h>
+
+// Process-wide table of subject names. Each distinct name is stored once
+// and known everywhere else by a dense id: 0, 1, 2, ...
+// Interning, lookups and names are thread safe, ids depend on interning
+// order.
+
+int subjects_init(void);
+void subjects_free(void);
+int subject_intern(const char* name, size_t len);
+int subject_find(const char* name, size_t len);
+const char* subject_name(int id);
+int subject_count(void);
+
+#endif
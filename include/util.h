@@ -7,30 +7,37 @@
 #ifndef POMOINTER_UTIL_H
 #define POMOINTER_UTIL_H
 
+#include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <time.h>
+#include "arena.h"
+
+// Dates are day numbers, days since 01/01/1970 (see days_from_civil())
+#define DAY_INVALID INT_MIN
+#define DATE_STRING_SIZE 16 // "dd/mm/yyyy", with room for any year
+
+// Helpers that return new memory take an arena to allocate it from, NULL
+// to use malloc()
 
 // Strings
-int count_stars(const char* str);
-char** split_string(const char* str, const char delimiter, int* count);
-char* strip_string(const char* str, const char* chars);
+char** split_string(Arena* arena, const char* str, const char delimiter, int* count);
 void free_string_array(char** array);
-char* trim_left(char* str);
+
+// String views (pointer and length, not NUL terminated)
+const char* trim_view(const char* str, size_t* len);
+char* string_from_view(Arena* arena, const char* str, size_t len);
 
 // Conversions
 int string_to_int(const char* str);
-char* int_to_string(int n);
-time_t string_to_time(const char* str);
-char* time_to_string(time_t time);
-
-// Booleans
-bool is_empty_str(const char* str);
-bool is_comment(const char* str);
-bool string_arr_contains(char** array, const char* string);
+int string_to_day(const char* str);
+char* day_to_string(int day, char* buffer);
+int days_from_civil(int year, int month, int day);
+void civil_from_days(int days, int* year, int* month, int* day);
+int time_to_day(time_t time);
 
 // Files
 time_t get_file_mod_date(const char* path);
-void print_file(const char* path);
 void extract_directory(const char* path, char* dir_buff, size_t buffer_size);
 
 #endif
@@ -0,0 +1,20 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_WALK_H
+#define POMOINTER_WALK_H
+
+#include "inputs.h"
+
+// Walks directories in the background, adding every .pf file found under
+// them to an input list, and closes it when done. Subdirectories are read
+// in parallel by the walker threads.
+typedef struct Walker Walker;
+
+Walker* walker_start(InputList* list, char** dirs, int dir_count, int threads);
+void walker_join(Walker* walker);
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#ifndef POMOINTER_WATCH_H
+#define POMOINTER_WATCH_H
+
+#include "inputs.h"
+#include "process_data.h"
+
+// Watches the already merged files and everything they include. Files that
+// change are parsed again and their registers replaced in the global ones,
+// then report() is called. Returns when interrupted, -1 on failure.
+int watch_run(InputList* inputs, ProcessData* process_data, void (*report)(void));
+
+#endif
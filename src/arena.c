@@ -0,0 +1,102 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGNMENT 16
+#define DEFAULT_BLOCK_SIZE 4096
+
+struct ArenaBlock {
+  ArenaBlock* next;
+  size_t used;
+  size_t size;
+  char data[];
+};
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static size_t padding(ArenaBlock* block);
+static ArenaBlock* add_block(Arena* arena, size_t size);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Bytes to skip so the next allocation of the block is aligned
+static size_t padding(ArenaBlock* block) {
+  uintptr_t address = (uintptr_t)(block->data + block->used);
+  return (ARENA_ALIGNMENT - address % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+}
+
+static ArenaBlock* add_block(Arena* arena, size_t size) {
+  // Room for the alignment of the first allocation too
+  size_t block_size = size + ARENA_ALIGNMENT > arena->block_size ? size + ARENA_ALIGNMENT : arena->block_size;
+
+  ArenaBlock* block = malloc(sizeof(ArenaBlock) + block_size);
+  if (!block) return NULL;
+
+  block->used = 0;
+  block->size = block_size;
+
+  if (arena->blocks && block_size > arena->block_size) {
+    // Oversized, keep allocating from the current one
+    block->next = arena->blocks->next;
+    arena->blocks->next = block;
+  } else {
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+
+  return block;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+void arena_init(Arena* arena, size_t block_size) {
+  arena->blocks = NULL; // Allocated on first use
+  arena->block_size = block_size > 0 ? block_size : DEFAULT_BLOCK_SIZE;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+  if (!arena) return NULL;
+
+  ArenaBlock* block = arena->blocks;
+
+  if (block == NULL || block->size - block->used < padding(block) + size) {
+    block = add_block(arena, size);
+    if (!block) return NULL;
+  }
+
+  block->used += padding(block);
+  void* memory = block->data + block->used;
+  block->used += size;
+
+  return memory;
+}
+
+char* arena_strndup(Arena* arena, const char* str, size_t len) {
+  char* copy = arena_alloc(arena, len + 1);
+  if (!copy) return NULL;
+
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+
+  return copy;
+}
+
+void arena_free(Arena* arena) {
+  if (!arena) return;
+
+  ArenaBlock* block = arena->blocks;
+  while (block) {
+    ArenaBlock* next = block->next;
+    free(block);
+    block = next;
+  }
+
+  arena->blocks = NULL;
+}
@@ -0,0 +1,133 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "day_index.h"
+
+// Days are sorted 16 bits at a time, one pass covers about 179 years
+#define RADIX_BITS 16
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static void radix_pass(const DayEntry* from, DayEntry* to, int size, int min_day, int shift, int* counts);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Stable counting sort of the entries by one digit of their distance to
+// min_day. counts has RADIX_SIZE + 1 ints.
+static void radix_pass(const DayEntry* from, DayEntry* to, int size, int min_day, int shift, int* counts) {
+  memset(counts, 0, sizeof(int) * (RADIX_SIZE + 1));
+
+  for (int i = 0; i < size; i++) {
+    uint32_t offset = (uint32_t)from[i].day - (uint32_t)min_day;
+    counts[((offset >> shift) & (RADIX_SIZE - 1)) + 1]++;
+  }
+
+  for (int digit = 0; digit < RADIX_SIZE; digit++) {
+    counts[digit + 1] += counts[digit];
+  }
+
+  for (int i = 0; i < size; i++) {
+    uint32_t offset = (uint32_t)from[i].day - (uint32_t)min_day;
+    to[counts[(offset >> shift) & (RADIX_SIZE - 1)]++] = from[i];
+  }
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+void day_index_init(DayIndex* index) {
+  index->days = NULL;
+  index->size = 0;
+  index->capacity = 0;
+  index->sorted = true;
+}
+
+// Adds a new date. The date string must outlive the index.
+int day_index_add(DayIndex* index, int day, char* date, RegisterMap* registers) {
+  if (index->size == index->capacity) {
+    int capacity = index->capacity > 0 ? index->capacity * 2 : 64;
+    DayEntry* days = realloc(index->days, capacity * sizeof(DayEntry));
+    if (days == NULL) {
+      return -1;
+    }
+
+    index->days = days;
+    index->capacity = capacity;
+  }
+
+  if (index->size > 0 && index->days[index->size - 1].day > day) {
+    index->sorted = false;
+  }
+
+  index->days[index->size].day = day;
+  index->days[index->size].date = date;
+  index->days[index->size].registers = registers;
+  index->size++;
+  return 0;
+}
+
+// Radix sort on the day numbers, linear in the number of dates
+void day_index_sort(DayIndex* index) {
+  if (index->sorted) return;
+
+  int min_day = index->days[0].day;
+  int max_day = index->days[0].day;
+  for (int i = 1; i < index->size; i++) {
+    if (index->days[i].day < min_day) min_day = index->days[i].day;
+    if (index->days[i].day > max_day) max_day = index->days[i].day;
+  }
+
+  DayEntry* buffer = malloc(sizeof(DayEntry) * index->capacity);
+  int* counts = malloc(sizeof(int) * (RADIX_SIZE + 1));
+  if (buffer == NULL || counts == NULL) {
+    free(buffer);
+    free(counts);
+    return;
+  }
+
+  // A second pass only for spans longer than one digit
+  uint32_t span = (uint32_t)max_day - (uint32_t)min_day;
+  radix_pass(index->days, buffer, index->size, min_day, 0, counts);
+  if (span >= RADIX_SIZE) {
+    radix_pass(buffer, index->days, index->size, min_day, RADIX_BITS, counts);
+  } else {
+    DayEntry* sorted = buffer;
+    buffer = index->days;
+    index->days = sorted;
+  }
+
+  free(buffer);
+  free(counts);
+  index->sorted = true;
+}
+
+// Position of the first date on or after day, size if there is none
+int day_index_lower_bound(DayIndex* index, int day) {
+  day_index_sort(index);
+
+  int low = 0;
+  int high = index->size;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+
+    if (index->days[middle].day < day) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+void day_index_free(DayIndex* index) {
+  free(index->days);
+  day_index_init(index);
+}
@@ -4,112 +4,494 @@
  * 
  * See LICENSE file for full BSD 3-Clause license terms.
  */
-#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
 #include "export.h"
+#include "output.h"
 
-void print_html_top_part(void) {
-  printf("<!DOCTYPE html>\n"
-         "<html lang=\"en\">\n"
-         "<head>\n"
-         " <meta charset=\"UTF-8\">\n"
-         " <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-         " <title>Pomodoros</title>\n"
-         " <style>\n"
-         "  body {\n"
-         "   font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;\n"
-         "   line-height: 1.6;\n"
-         "   max-width: 900px;\n"
-         "   margin: 0 auto;\n"
-         "   padding: 20px;\n"
-         "   background-color: #f8f9fa;\n"
-         "   color: #333;\n"
-         "  }\n\n"
-         "  h1 {\n"
-         "   text-align: center\n"
-         "   color: #d63031;\n"
-         "   padding-bottom: 15px; \n"
-         "   border-bottom: 2px solid #dfe6e9;\n"
-         "   margin-bottom: 30px;\n"
-         "  }\n\n"
-         "  div {\n"
-         "   background-color: white;\n"
-         "   border-radius: 8px; \n"
-         "   padding: 20px;\n"
-         "   margin-bottom: 25px;\n"
-         "   box-shadow: 0 2px 8px rgba(0, 0, 0, 0.08);\n"
-         "   border: 1px solid #e9ecef;\n"
-         "  }\n\n"
-         "  h2 {\n"
-         "   color: #2d3436;\n"
-         "   background-color: #fff5f5;\n"
-         "   padding: 12px 15px;\n"
-         "   border-radius: 6px;\n"
-         "   margin: -20px -20px 20px -20px;\n"
-         "   border-left: 4px solid #d63031;\n"
-         "   font-size: 1.2rem;\n"
-         "  }\n\n"
-         "  table {\n"
-         "   width: 100%%;\n"
-         "   border-collapse: collapse;\n"
-         "  }\n\n"
-         "  th {\n"
-         "   background-color: #f8f9fa; \n"
-         "   text-align: left; \n"
-         "   padding: 12px 15px; \n"
-         "   border-bottom: 2px solid #dfe6e9; \n"
-         "   color: #495057; \n"
-         "   font-weight: 600; \n"
-         "  }\n\n"
-         "  td {\n"
-         "   padding: 12px 15px; \n"
-         "   border-bottom: 1px solid #e9ecef;\n"
-         "  }\n\n"
-         "  tr:hover {\n"
-         "   background-color: #f8f9fa;\n"
-         "  }\n\n"
-         "  tr:last-child td {\n"
-         "   border-bottom: none;\n"
-         "  }\n\n"
-         "  .subject {\n"
-         "   font-weight: 500;\n"
-         "   color: #2d3436;\n"
-         "  }\n\n"
-         "  .tomato {\n"
-         "    color: #d63031;\n"
-         "    font-size: 1.1rem;\n"
-         "    letter-spacing: 2px;\n"
-         "  }\n\n"
-         "  .time {\n"
-         "    font-weight: 500;\n"
-         "    color: #0984e3;\n"
-         "  }\n\n"
-         " </style>\n"
-         "</head>\n"
-         "<body>\n"
-         " <h1>Pomodoros</h1>\n"
-         );
-}
-
-void print_table_top_part(const char* date, char* pomodoro_duration) {
-  printf(" <div>\n"
-         "  <h2>%s - 🍅 = %s</h2>\n"
-         "   <table>\n"
-         "    <tr>\n"
-         "     <th>Subject</th>\n"
-         "     <th>Ammount</th>\n"
-         "     <th>Time</th>\n"
-         "    </tr>\n",
-         date,
-         pomodoro_duration
-         );
-}
-
-void print_table_down_part(void) {
-  printf("   </table>\n"
-         " </div>\n");
-}
- 
-void print_html_down_part(void) {
-  printf("</body>\n"
-         "</html>\n");
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static void nothing(void);
+static void nothing_date(const char* date, int pomodoro_duration);
+static void nothing_period(const char* period);
+static void output_json_string(const char* str);
+static void output_csv_field(const char* str);
+
+static void text_begin_date(const char* date, int pomodoro_duration);
+static void text_row(const char* date, const char* subject, int pomodoros, long long minutes);
+static void text_begin_summary(void);
+static void text_summary_row(const char* subject, long long pomodoros, long long minutes);
+static void text_begin_period(const char* period);
+static void text_period_row(const char* period, const char* subject, long long pomodoros, long long minutes);
+
+static void html_begin(void);
+static void html_begin_date(const char* date, int pomodoro_duration);
+static void html_row(const char* date, const char* subject, int pomodoros, long long minutes);
+static void html_end_date(void);
+static void html_end(void);
+static void html_begin_summary(void);
+static void html_summary_row(const char* subject, long long pomodoros, long long minutes);
+static void html_end_summary(void);
+static void html_begin_period(const char* period);
+static void html_period_row(const char* period, const char* subject, long long pomodoros, long long minutes);
+
+static void csv_begin(void);
+static void csv_row(const char* date, const char* subject, int pomodoros, long long minutes);
+static void csv_begin_summary(void);
+static void csv_summary_row(const char* subject, long long pomodoros, long long minutes);
+static void csv_begin_periods(void);
+static void csv_period_row(const char* period, const char* subject, long long pomodoros, long long minutes);
+
+static void json_begin(void);
+static void json_begin_date(const char* date, int pomodoro_duration);
+static void json_row(const char* date, const char* subject, int pomodoros, long long minutes);
+static void json_end_date(void);
+static void json_end(void);
+static void json_summary_row(const char* subject, long long pomodoros, long long minutes);
+static void json_begin_period(const char* period);
+static void json_period_row(const char* period, const char* subject, long long pomodoros, long long minutes);
+
+static void ndjson_row(const char* date, const char* subject, int pomodoros, long long minutes);
+static void ndjson_summary_row(const char* subject, long long pomodoros, long long minutes);
+static void ndjson_period_row(const char* period, const char* subject, long long pomodoros, long long minutes);
+
+static void output_subject_object(const char* subject, long long pomodoros, long long minutes);
+
+// Commas go before every element but the first. Per thread, --serve
+// renders several reports at once.
+static __thread bool json_first_date;
+static __thread bool json_first_row;
+
+static const Exporter exporters[] = {
+  {"text", nothing, text_begin_date, text_row, nothing, nothing,
+   text_begin_summary, text_summary_row, nothing,
+   nothing, text_begin_period, text_period_row, nothing, nothing},
+  {"html", html_begin, html_begin_date, html_row, html_end_date, html_end,
+   html_begin_summary, html_summary_row, html_end_summary,
+   html_begin, html_begin_period, html_period_row, html_end_date, html_end},
+  {"csv", csv_begin, nothing_date, csv_row, nothing, nothing,
+   csv_begin_summary, csv_summary_row, nothing,
+   csv_begin_periods, nothing_period, csv_period_row, nothing, nothing},
+  {"json", json_begin, json_begin_date, json_row, json_end_date, json_end,
+   json_begin, json_summary_row, json_end,
+   json_begin, json_begin_period, json_period_row, json_end_date, json_end},
+  {"ndjson", nothing, nothing_date, ndjson_row, nothing, nothing,
+   nothing, ndjson_summary_row, nothing,
+   nothing, nothing_period, ndjson_period_row, nothing, nothing}
+};
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+static void nothing(void) {
+}
+
+static void nothing_date(const char* date, int pomodoro_duration) {
+  (void)date;
+  (void)pomodoro_duration;
+}
+
+static void nothing_period(const char* period) {
+  (void)period;
+}
+
+static void output_json_string(const char* str) {
+  static const char hex[] = "0123456789abcdef";
+  const char* start = str;
+
+  output_char('"');
+  for (; *str != '\0'; str++) {
+    unsigned char c = (unsigned char)*str;
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    output_write(start, str - start);
+    if (c == '"' || c == '\\') {
+      output_char('\\');
+      output_char((char)c);
+    } else {
+      output_write("\\u00", 4);
+      output_char(hex[c >> 4]);
+      output_char(hex[c & 0xf]);
+    }
+    start = str + 1;
+  }
+  output_write(start, str - start);
+  output_char('"');
+}
+
+// Quoted only when it has to be, doubling the quotes inside
+static void output_csv_field(const char* str) {
+  if (strpbrk(str, ",\"\r\n") == NULL) {
+    output_string(str);
+    return;
+  }
+
+  output_char('"');
+  for (; *str != '\0'; str++) {
+    if (*str == '"') {
+      output_char('"');
+    }
+    output_char(*str);
+  }
+  output_char('"');
+}
+
+static void text_begin_date(const char* date, int pomodoro_duration) {
+  output_string("\nDate: ");
+  output_string(date);
+  output_string(" - Pomodoro length: ");
+  output_int(pomodoro_duration);
+  output_string(" min\n");
+}
+
+static void text_row(const char* date, const char* subject, int pomodoros, long long minutes) {
+  (void)date;
+
+  output_string(subject);
+  output_write(":\n", 2);
+  output_tomatoes(pomodoros);
+  output_write(" -> ", 4);
+  output_minutes(minutes);
+  output_char('\n');
+}
+
+static void text_begin_summary(void) {
+  output_string("\nSummary\n");
+}
+
+// Totals can be long, so the tomatoes are counted instead of drawn
+static void text_summary_row(const char* subject, long long pomodoros, long long minutes) {
+  output_string(subject);
+  output_write(": ", 2);
+  output_long(pomodoros);
+  output_string(" 🍅 -> ");
+  output_minutes(minutes);
+  output_char('\n');
+}
+
+static void text_begin_period(const char* period) {
+  output_string("\nPeriod: ");
+  output_string(period);
+  output_char('\n');
+}
+
+static void text_period_row(const char* period, const char* subject, long long pomodoros, long long minutes) {
+  (void)period;
+  text_summary_row(subject, pomodoros, minutes);
+}
+
+static void html_begin(void) {
+  output_string("<!DOCTYPE html>\n"
+                "<html lang=\"en\">\n"
+                "<head>\n"
+                " <meta charset=\"UTF-8\">\n"
+                " <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+                " <title>Pomodoros</title>\n"
+                " <style>\n"
+                "  body {\n"
+                "   font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;\n"
+                "   line-height: 1.6;\n"
+                "   max-width: 900px;\n"
+                "   margin: 0 auto;\n"
+                "   padding: 20px;\n"
+                "   background-color: #f8f9fa;\n"
+                "   color: #333;\n"
+                "  }\n\n"
+                "  h1 {\n"
+                "   text-align: center\n"
+                "   color: #d63031;\n"
+                "   padding-bottom: 15px; \n"
+                "   border-bottom: 2px solid #dfe6e9;\n"
+                "   margin-bottom: 30px;\n"
+                "  }\n\n"
+                "  div {\n"
+                "   background-color: white;\n"
+                "   border-radius: 8px; \n"
+                "   padding: 20px;\n"
+                "   margin-bottom: 25px;\n"
+                "   box-shadow: 0 2px 8px rgba(0, 0, 0, 0.08);\n"
+                "   border: 1px solid #e9ecef;\n"
+                "  }\n\n"
+                "  h2 {\n"
+                "   color: #2d3436;\n"
+                "   background-color: #fff5f5;\n"
+                "   padding: 12px 15px;\n"
+                "   border-radius: 6px;\n"
+                "   margin: -20px -20px 20px -20px;\n"
+                "   border-left: 4px solid #d63031;\n"
+                "   font-size: 1.2rem;\n"
+                "  }\n\n"
+                "  table {\n"
+                "   width: 100%;\n"
+                "   border-collapse: collapse;\n"
+                "  }\n\n"
+                "  th {\n"
+                "   background-color: #f8f9fa; \n"
+                "   text-align: left; \n"
+                "   padding: 12px 15px; \n"
+                "   border-bottom: 2px solid #dfe6e9; \n"
+                "   color: #495057; \n"
+                "   font-weight: 600; \n"
+                "  }\n\n"
+                "  td {\n"
+                "   padding: 12px 15px; \n"
+                "   border-bottom: 1px solid #e9ecef;\n"
+                "  }\n\n"
+                "  tr:hover {\n"
+                "   background-color: #f8f9fa;\n"
+                "  }\n\n"
+                "  tr:last-child td {\n"
+                "   border-bottom: none;\n"
+                "  }\n\n"
+                "  .subject {\n"
+                "   font-weight: 500;\n"
+                "   color: #2d3436;\n"
+                "  }\n\n"
+                "  .tomato {\n"
+                "    color: #d63031;\n"
+                "    font-size: 1.1rem;\n"
+                "    letter-spacing: 2px;\n"
+                "  }\n\n"
+                "  .time {\n"
+                "    font-weight: 500;\n"
+                "    color: #0984e3;\n"
+                "  }\n\n"
+                " </style>\n"
+                "</head>\n"
+                "<body>\n"
+                " <h1>Pomodoros</h1>\n"
+                );
+}
+
+static void html_begin_date(const char* date, int pomodoro_duration) {
+  output_string(" <div>\n"
+                "  <h2>");
+  output_string(date);
+  output_string(" - 🍅 = ");
+  output_minutes(pomodoro_duration);
+  output_string("</h2>\n"
+                "   <table>\n"
+                "    <tr>\n"
+                "     <th>Subject</th>\n"
+                "     <th>Ammount</th>\n"
+                "     <th>Time</th>\n"
+                "    </tr>\n");
+}
+
+static void html_row(const char* date, const char* subject, int pomodoros, long long minutes) {
+  (void)date;
+
+  output_string("    <tr>\n"
+                "     <td class=\"subject\">");
+  output_string(subject);
+  output_string("</td>\n"
+                "     <td class=\"tomato\">");
+  output_tomatoes(pomodoros);
+  output_string("</td>\n"
+                "     <td class=\"time\">");
+  output_minutes(minutes);
+  output_string("</td>\n"
+                "    </tr>\n");
+}
+
+static void html_end_date(void) {
+  output_string("   </table>\n"
+                " </div>\n");
+}
+static void html_end(void) {
+  output_string("</body>\n"
+                "</html>\n");
+}
+
+static void html_begin_summary(void) {
+  html_begin();
+  html_begin_period("Summary");
+}
+
+static void html_begin_period(const char* period) {
+  output_string(" <div>\n"
+                "  <h2>");
+  output_string(period);
+  output_string("</h2>\n"
+                "   <table>\n"
+                "    <tr>\n"
+                "     <th>Subject</th>\n"
+                "     <th>Ammount</th>\n"
+                "     <th>Time</th>\n"
+                "    </tr>\n");
+}
+
+static void html_summary_row(const char* subject, long long pomodoros, long long minutes) {
+  output_string("    <tr>\n"
+                "     <td class=\"subject\">");
+  output_string(subject);
+  output_string("</td>\n"
+                "     <td class=\"tomato\">");
+  output_long(pomodoros);
+  output_string(" 🍅</td>\n"
+                "     <td class=\"time\">");
+  output_minutes(minutes);
+  output_string("</td>\n"
+                "    </tr>\n");
+}
+
+static void html_end_summary(void) {
+  html_end_date();
+  html_end();
+}
+
+static void html_period_row(const char* period, const char* subject, long long pomodoros, long long minutes) {
+  (void)period;
+  html_summary_row(subject, pomodoros, minutes);
+}
+
+static void csv_begin(void) {
+  output_string("date,subject,pomodoros,minutes\n");
+}
+
+static void csv_row(const char* date, const char* subject, int pomodoros, long long minutes) {
+  output_csv_field(date);
+  output_char(',');
+  output_csv_field(subject);
+  output_char(',');
+  output_int(pomodoros);
+  output_char(',');
+  output_long(minutes);
+  output_char('\n');
+}
+
+static void csv_begin_summary(void) {
+  output_string("subject,pomodoros,minutes\n");
+}
+
+static void csv_summary_row(const char* subject, long long pomodoros, long long minutes) {
+  output_csv_field(subject);
+  output_char(',');
+  output_long(pomodoros);
+  output_char(',');
+  output_long(minutes);
+  output_char('\n');
+}
+
+static void csv_begin_periods(void) {
+  output_string("period,subject,pomodoros,minutes\n");
+}
+
+static void csv_period_row(const char* period, const char* subject, long long pomodoros, long long minutes) {
+  output_csv_field(period);
+  output_char(',');
+  csv_summary_row(subject, pomodoros, minutes);
+}
+
+static void json_begin(void) {
+  json_first_date = true;
+  output_char('[');
+}
+
+static void json_begin_date(const char* date, int pomodoro_duration) {
+  output_string(json_first_date ? "\n" : ",\n");
+  output_string("{\"date\":");
+  output_json_string(date);
+  output_string(",\"pomodoro_duration\":");
+  output_int(pomodoro_duration);
+  output_string(",\"subjects\":[");
+  json_first_date = false;
+  json_first_row = true;
+}
+
+static void json_row(const char* date, const char* subject, int pomodoros, long long minutes) {
+  (void)date;
+
+  output_string(json_first_row ? "\n " : ",\n ");
+  output_string("{\"subject\":");
+  output_json_string(subject);
+  output_string(",\"pomodoros\":");
+  output_int(pomodoros);
+  output_string(",\"minutes\":");
+  output_long(minutes);
+  output_char('}');
+  json_first_row = false;
+}
+
+static void json_end_date(void) {
+  output_string("]}");
+}
+
+static void json_end(void) {
+  output_string("\n]\n");
+}
+
+static void json_summary_row(const char* subject, long long pomodoros, long long minutes) {
+  output_string(json_first_date ? "\n" : ",\n");
+  output_subject_object(subject, pomodoros, minutes);
+  json_first_date = false;
+}
+
+static void json_begin_period(const char* period) {
+  output_string(json_first_date ? "\n" : ",\n");
+  output_string("{\"period\":");
+  output_json_string(period);
+  output_string(",\"subjects\":[");
+  json_first_date = false;
+  json_first_row = true;
+}
+
+static void json_period_row(const char* period, const char* subject, long long pomodoros, long long minutes) {
+  (void)period;
+
+  output_string(json_first_row ? "\n " : ",\n ");
+  output_subject_object(subject, pomodoros, minutes);
+  json_first_row = false;
+}
+
+// One object per row, nothing kept between them
+static void ndjson_row(const char* date, const char* subject, int pomodoros, long long minutes) {
+  output_string("{\"date\":");
+  output_json_string(date);
+  output_string(",\"subject\":");
+  output_json_string(subject);
+  output_string(",\"pomodoros\":");
+  output_int(pomodoros);
+  output_string(",\"minutes\":");
+  output_long(minutes);
+  output_string("}\n");
+}
+
+static void ndjson_summary_row(const char* subject, long long pomodoros, long long minutes) {
+  output_subject_object(subject, pomodoros, minutes);
+  output_char('\n');
+}
+
+static void ndjson_period_row(const char* period, const char* subject, long long pomodoros, long long minutes) {
+  output_string("{\"period\":");
+  output_json_string(period);
+  output_string(",\"subject\":");
+  output_json_string(subject);
+  output_string(",\"pomodoros\":");
+  output_long(pomodoros);
+  output_string(",\"minutes\":");
+  output_long(minutes);
+  output_string("}\n");
+}
+
+static void output_subject_object(const char* subject, long long pomodoros, long long minutes) {
+  output_string("{\"subject\":");
+  output_json_string(subject);
+  output_string(",\"pomodoros\":");
+  output_long(pomodoros);
+  output_string(",\"minutes\":");
+  output_long(minutes);
+  output_char('}');
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// Exporter called name, NULL if there's none
+const Exporter* exporter_find(const char* name) {
+  for (size_t i = 0; i < sizeof(exporters) / sizeof(exporters[0]); i++) {
+    if (strcmp(exporters[i].name, name) == 0) {
+      return &exporters[i];
+    }
+  }
+
+  return NULL;
 }
@@ -4,54 +4,129 @@
  * 
  * See LICENSE file for full BSD 3-Clause license terms.
  */
-#define _POSIX_C_SOURCE 200809L // For strdup
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include "hashmap.h"
+#include "stats.h"
+
+#define KEY_CHUNK_SIZE 4096
 
 /* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
 
-static unsigned long hash(const char* str, int capacity);
-static Entry* create_entry(const char* key, void* value);
-static void free_entry(Entry* entry, void (*free_value)(void*));
+static unsigned int hash(const char* str, size_t len);
+static int round_capacity(int capacity);
+static int probe_distance(HashMap* map, int index);
+static char* store_key(HashMap* map, const char* key, size_t len);
+static Entry* find_entry(HashMap* map, const char* key, size_t len, unsigned int key_hash);
+static void insert_entry(HashMap* map, Entry entry);
 
 /* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
 
-// Hash function(djb2 algorithm)
-static unsigned long hash(const char* str, int capacity) {
-  unsigned long hash = 5381;
-  int c;
+// Hash function(FNV-1a, 64 bits)
+static unsigned int hash(const char* str, size_t len) {
+  unsigned long long hash = 14695981039346656037ULL;
 
-  while ((c = *str++)) {
-    hash = ((hash << 5) + hash) + c; // hash * 33 + c
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)str[i];
+    hash *= 1099511628211ULL;
   }
 
-  return hash % capacity;
+  // Low bits pick the slot, fold the high ones into them
+  hash ^= hash >> 32;
+  return (unsigned int)hash;
 }
 
-// Function to create entry
-static Entry* create_entry(const char* key, void* value) {
-  Entry* entry = (Entry*)malloc(sizeof(Entry));
-  if (!entry) return NULL;
+// Smallest power of two not below capacity
+static int round_capacity(int capacity) {
+  int rounded = 16;
 
-  entry->key = strdup(key);
-  entry->value = value;
-  entry->next = NULL;
+  while (rounded < capacity) {
+    rounded *= 2;
+  }
 
-  return entry;
+  return rounded;
 }
 
-// Function to free an entry
-static void free_entry(Entry* entry, void (*free_value)(void*)) {
-  if (!entry) return;
+// How far the entry at index is from its home slot
+static int probe_distance(HashMap* map, int index) {
+  int mask = map->capacity - 1;
+  int home = (int)(map->buckets[index].hash & mask);
 
-  free(entry->key);
-  if (free_value && entry->value) {
-    free_value(entry->value);
+  return (index - home) & mask;
+}
+
+// Copies a key to the map's key storage
+static char* store_key(HashMap* map, const char* key, size_t len) {
+  KeyChunk* chunk = map->keys;
+
+  if (chunk == NULL || chunk->size - chunk->used < len + 1) {
+    size_t size = len + 1 > KEY_CHUNK_SIZE ? len + 1 : KEY_CHUNK_SIZE;
+
+    chunk = malloc(sizeof(KeyChunk) + size);
+    if (!chunk) return NULL;
+
+    chunk->next = map->keys;
+    chunk->used = 0;
+    chunk->size = size;
+    map->keys = chunk;
+  }
+
+  char* stored = chunk->data + chunk->used;
+  memcpy(stored, key, len);
+  stored[len] = '\0';
+  chunk->used += len + 1;
+
+  return stored;
+}
+
+// Probes from the home slot until the key, an empty slot, or an entry
+// closer to its home than the key would be
+static Entry* find_entry(HashMap* map, const char* key, size_t len, unsigned int key_hash) {
+  int mask = map->capacity - 1;
+  int index = (int)(key_hash & mask);
+
+  for (int distance = 0; ; distance++) {
+    Entry* entry = &map->buckets[index];
+
+    if (entry->key == NULL || probe_distance(map, index) < distance) {
+      return NULL;
+    }
+
+    if (entry->hash == key_hash && entry->length == len && memcmp(entry->key, key, len) == 0) {
+      return entry;
+    }
+
+    index = (index + 1) & mask;
   }
+}
+
+// Inserts an entry whose key isn't in the map. Entries far from their home
+// slot take the place of those that are closer to theirs.
+static void insert_entry(HashMap* map, Entry entry) {
+  int mask = map->capacity - 1;
+  int index = (int)(entry.hash & mask);
+
+  for (int distance = 0; ; distance++) {
+    Entry* slot = &map->buckets[index];
 
-  free(entry);
+    if (slot->key == NULL) {
+      *slot = entry;
+      map->size++;
+      return;
+    }
+
+    int slot_distance = probe_distance(map, index);
+    if (slot_distance < distance) {
+      Entry displaced = *slot;
+      *slot = entry;
+      entry = displaced;
+      distance = slot_distance;
+    }
+
+    index = (index + 1) & mask;
+  }
 }
 
 /* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
@@ -61,11 +136,12 @@ HashMap* hashmap_create(int initial_capacity, float load_factor) {
   HashMap* map = (HashMap*)malloc(sizeof(HashMap));
   if (!map) return NULL;
 
-  map->capacity = initial_capacity > 0 ? initial_capacity : 16;
+  map->capacity = round_capacity(initial_capacity);
   map->size = 0;
   map->load_factor = (load_factor > 0.1 && load_factor < 1.0) ? load_factor : 0.75;
+  map->keys = NULL;
 
-  map->buckets = (Entry**)calloc(map->capacity, sizeof(Entry*));
+  map->buckets = (Entry*)calloc(map->capacity, sizeof(Entry));
   if (!map->buckets) {
     free(map);
     return NULL;
@@ -74,108 +150,114 @@ HashMap* hashmap_create(int initial_capacity, float load_factor) {
   return map;
 }
 
-// Resizes hashmap
-void hashmap_resize(HashMap* map) {
+// Resizes hashmap. Returns -1 when the new slots can't be allocated, the
+// map is left as it was.
+int hashmap_resize(HashMap* map) {
+  STATS_ADD(hashmap_resizes, 1);
   int old_capacity = map->capacity;
-  Entry** old_buckets = map->buckets;
+  Entry* old_buckets = map->buckets;
 
   // Double its capacity
-  map->capacity *= 2;
-  map->buckets = (Entry**)calloc(map->capacity, sizeof(Entry*));
-  map->size = 0; // Will be recalculated during rehashing
+  Entry* buckets = (Entry*)calloc(old_capacity * 2, sizeof(Entry));
+  if (!buckets) return -1;
 
-  // Reinsert old elements
-  for (int i = 0; i < old_capacity; i++) {
-    Entry* entry = old_buckets[i];
-    while (entry) {
-      Entry* next = entry->next;
-
-      // Reinsert in the new bucket
-      unsigned long index = hash(entry->key, map->capacity);
-      entry->next = map->buckets[index];
-      map->buckets[index] = entry;
-      map->size++;
+  map->capacity = old_capacity * 2;
+  map->buckets = buckets;
+  map->size = 0; // Will be recalculated during reinsertion
 
-      entry = next;
+  // Reinsert old elements, with their cached hashes
+  for (int i = 0; i < old_capacity; i++) {
+    if (old_buckets[i].key) {
+      insert_entry(map, old_buckets[i]);
     }
   }
 
   free(old_buckets);
+  return 0;
 }
 
 
-// Insert or update an element
-void hashmap_put(HashMap* map, const char* key, void* value) {
-  if (!map || !key ) return;
+// Insert or update an element. Returns -1 when it couldn't be added.
+int hashmap_put(HashMap* map, const char* key, void* value) {
+  if (!map || !key ) return -1;
 
-  // Verify if it needs to resize
-  if ((float)map->size / map->capacity >= map->load_factor) {
-    hashmap_resize(map);
-  }
+  return hashmap_put_len(map, key, strlen(key), value);
+}
 
-  unsigned long index = hash(key, map->capacity);
-  Entry* entry = map->buckets[index];
+// Same as hashmap_put(), for a key that isn't NUL terminated
+int hashmap_put_len(HashMap* map, const char* key, size_t len, void* value) {
+  if (!map || !key || len > UINT_MAX) return -1;
 
-  while (entry) {
-    if (strcmp(entry->key, key) == 0) {
-      // Update its value
-      entry->value = value;
-      return ;
-    }
-    entry = entry->next;
+  unsigned int key_hash = hash(key, len);
+  Entry* entry = find_entry(map, key, len, key_hash);
+
+  if (entry) {
+    // Update its value
+    entry->value = value;
+    return 0;
+  }
+
+  // Verify if it needs to resize. If it can't, a map with a free slot
+  // keeps working with longer probes, a full one would probe forever.
+  if ((float)(map->size + 1) / map->capacity > map->load_factor &&
+      hashmap_resize(map) < 0 && map->size >= map->capacity) {
+    return -1;
   }
 
-  // Create new entry(at the start of the list)
-  Entry* new_entry = create_entry(key, value); 
-  if (!new_entry) return;
+  Entry new_entry;
+  new_entry.key = store_key(map, key, len);
+  if (!new_entry.key) return -1;
 
-  new_entry->next = map->buckets[index];
-  map->buckets[index] = new_entry;
-  map->size++;
+  new_entry.value = value;
+  new_entry.hash = key_hash;
+  new_entry.length = (unsigned int)len;
+  insert_entry(map, new_entry);
+  return 0;
 }
 
 // Obtains an element by the key
 void* hashmap_get(HashMap* map, const char* key) {
   if (!map || !key) return NULL;
 
-  unsigned long index = hash(key, map->capacity);
-  Entry* entry = map->buckets[index];
+  return hashmap_get_len(map, key, strlen(key));
+}
 
-  while (entry) {
-    if (strcmp(entry->key, key) == 0) {
-      return entry->value;
-    }
-    entry = entry->next;
-  }
+// Same as hashmap_get(), for a key that isn't NUL terminated
+void* hashmap_get_len(HashMap* map, const char* key, size_t len) {
+  if (!map || !key || len > UINT_MAX) return NULL;
+
+  Entry* entry = find_entry(map, key, len, hash(key, len));
 
-  return NULL; // Not found
+  return entry ? entry->value : NULL; // NULL if not found
 }
 
-// Removes an element
+// Removes an element. Its key stays in the key storage until the map is
+// destroyed.
 int hashmap_remove(HashMap* map, const char* key, void (*free_value)(void*)) {
   if (!map || !key) return 0;
 
-  unsigned long index = hash(key, map->capacity);
-  Entry* entry = map->buckets[index];
-  Entry* prev = NULL;
+  size_t len = strlen(key);
+  Entry* entry = find_entry(map, key, len, hash(key, len));
+  if (!entry) return 0; // Key not found
 
-  while (entry) {
-    if (strcmp(entry->key, key) == 0) {
-      if (prev) {
-        prev->next = entry->next;
-      } else {
-        map->buckets[index] = entry->next;
-      }
+  if (free_value && entry->value) {
+    free_value(entry->value);
+  }
 
-      free_entry(entry, free_value);
-      map->size--;
-      return 1; // Removed
-    }
-    prev = entry;
-    entry = entry->next;
+  // Shift the following entries of the probe back by one slot
+  int mask = map->capacity - 1;
+  int index = (int)(entry - map->buckets);
+  int next = (index + 1) & mask;
+
+  while (map->buckets[next].key && probe_distance(map, next) > 0) {
+    map->buckets[index] = map->buckets[next];
+    index = next;
+    next = (next + 1) & mask;
   }
 
-  return 0; // Key not found
+  map->buckets[index].key = NULL;
+  map->size--;
+  return 1; // Removed
 }
 
 // Checks if the key exists
@@ -192,15 +274,21 @@ int hashmap_size(HashMap* map) {
 void hashmap_destroy(HashMap* map, void (*free_value)(void*)) {
   if (!map) return;
 
-  for (int i = 0; i < map->capacity; i++) {
-    Entry* entry = map->buckets[i];
-    while (entry) {
-      Entry* next = entry->next;
-      free_entry(entry, free_value);
-      entry = next;
+  if (free_value) {
+    for (int i = 0; i < map->capacity; i++) {
+      if (map->buckets[i].key && map->buckets[i].value) {
+        free_value(map->buckets[i].value);
+      }
     }
   }
 
+  KeyChunk* chunk = map->keys;
+  while (chunk) {
+    KeyChunk* next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+
   free(map->buckets);
   free(map);
 }
@@ -209,19 +297,12 @@ int hashmap_merge_inplace(HashMap* dest, HashMap* src) {
   if (!dest || !src) return 0;
   int added_elements = 0;
   for (int i = 0; i < src->capacity; i++) {
-    Entry* entry = src->buckets[i];
-    while (entry) {
-      void* current_value = hashmap_get(dest, entry->key);
-
-      if (current_value) {
-        hashmap_put(dest, entry->key, entry->value);
-      } else {
-        hashmap_put(dest, entry->key, entry->value);
-        added_elements++;
-      }
+    Entry* entry = &src->buckets[i];
+    if (!entry->key) continue;
 
-      entry = entry->next;
-    }
+    int old_size = dest->size;
+    hashmap_put_len(dest, entry->key, entry->length, entry->value);
+    added_elements += dest->size - old_size;
   }
   return added_elements;
 }
@@ -232,28 +313,28 @@ void hashmap_foreach(HashMap* map, void (*callback)(const char*, void*, void*),
   if (!map || !callback) return ;
 
   for (int i = 0; i < map->capacity; i++) {
-    Entry* entry = map->buckets[i];
-    while (entry) {
+    Entry* entry = &map->buckets[i];
+    if (entry->key) {
       callback(entry->key, entry->value, user_data);
-      entry = entry->next;
     }
   }
 }
 
 
-// Advances the iterator 
+// Advances the iterator
 int hashmap_iterator_next(HashMapIterator* iter) {
   if (!iter || !iter->map) return 0;
 
-  if (iter->current_entry) {
-    iter->current_entry = iter->current_entry->next;
-  }
+  iter->current_entry = NULL;
 
-  // If the current list is empty, look for the next non-empty bucket.
+  // Look for the next used slot
   while ( (!iter->current_entry) && (iter->bucket_index < iter->map->capacity) ) {
-    iter->current_entry = iter->map->buckets[iter->bucket_index];
+    Entry* entry = &iter->map->buckets[iter->bucket_index];
+    if (entry->key) {
+      iter->current_entry = entry;
+    }
     iter->bucket_index++;
-  } 
+  }
 
   return iter->current_entry != NULL;
 
@@ -261,7 +342,7 @@ int hashmap_iterator_next(HashMapIterator* iter) {
 
 // Creates an iterator
 HashMapIterator* hashmap_iterator_create(HashMap* map) {
-  if (!map) return NULL; 
+  if (!map) return NULL;
 
   HashMapIterator* iter = (HashMapIterator*)malloc(sizeof(HashMapIterator));
   if (!iter) return NULL;
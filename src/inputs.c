@@ -0,0 +1,361 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "inputs.h"
+
+// Inputs are allocated in chunks, so they never move as the list grows
+#define CHUNK_SIZE 1024
+#define PATH_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Where the chunks are. A bigger table replaces it as the list grows, the
+// old ones are kept until the list is destroyed, so a worker can look an
+// input up without the list lock.
+typedef struct ChunkTable {
+  struct ChunkTable* previous;
+  int capacity;
+  Input* chunks[];
+} ChunkTable;
+
+// Inputs handed to a worker and not started yet: [begin, end). The owner
+// takes from the front, thieves take the back half.
+typedef struct {
+  pthread_mutex_t lock;
+  int begin;
+  int end;
+} WorkDeque;
+
+struct InputList {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;  // Inputs added or parsed, or no more producers
+  ChunkTable* table;
+  int chunk_count;
+  int count;
+  int claimed;             // Inputs before it were handed to a worker
+  int producers;           // Still adding inputs
+  WorkDeque* deques;       // One per worker, the merging thread's first
+  int workers;
+  Arena paths;
+};
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static Input* input_at(InputList* list, int index);
+static int pop_input(WorkDeque* deque);
+static bool take_unclaimed(InputList* list, int worker);
+static bool steal_inputs(InputList* list, int thief);
+static int next_input(InputList* list, int worker);
+static int compare_walk_paths(const char* a, const char* b);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Any input added so far, with or without the lock
+static Input* input_at(InputList* list, int index) {
+  ChunkTable* table = __atomic_load_n(&list->table, __ATOMIC_ACQUIRE);
+  return &table->chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+}
+
+// Takes the next input from the front of a worker's own deque, -1 if empty
+static int pop_input(WorkDeque* deque) {
+  int index = -1;
+
+  pthread_mutex_lock(&deque->lock);
+  if (deque->begin < deque->end) {
+    index = deque->begin++;
+  }
+  pthread_mutex_unlock(&deque->lock);
+
+  return index;
+}
+
+// Needs the list lock. Hands an empty deque its share of the unclaimed
+// inputs, as if they were split evenly between the workers. False if every
+// input added so far was claimed.
+static bool take_unclaimed(InputList* list, int worker) {
+  int unclaimed = list->count - list->claimed;
+  if (unclaimed == 0) {
+    return false;
+  }
+
+  int share = (unclaimed + list->workers - 1) / list->workers;
+  WorkDeque* own = &list->deques[worker];
+
+  pthread_mutex_lock(&own->lock);
+  own->begin = list->claimed;
+  own->end = list->claimed + share;
+  pthread_mutex_unlock(&own->lock);
+
+  list->claimed += share;
+  return true;
+}
+
+// Moves the back half of some victim's deque into the thief's empty one.
+// False when every other deque is empty.
+static bool steal_inputs(InputList* list, int thief) {
+  for (int i = 1; i < list->workers; i++) {
+    WorkDeque* victim = &list->deques[(thief + i) % list->workers];
+    int begin = 0, end = 0;
+
+    pthread_mutex_lock(&victim->lock);
+    int remaining = victim->end - victim->begin;
+    if (remaining > 0) {
+      // Leave the victim the front half, it is already working on it
+      end = victim->end;
+      begin = victim->end - (remaining + 1) / 2;
+      victim->end = begin;
+    }
+    pthread_mutex_unlock(&victim->lock);
+
+    if (end > begin) {
+      WorkDeque* own = &list->deques[thief];
+      pthread_mutex_lock(&own->lock);
+      own->begin = begin;
+      own->end = end;
+      pthread_mutex_unlock(&own->lock);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Needs the list lock. Next input for a worker: from its deque, then from
+// the unclaimed ones, then stolen. -1 if there is none right now.
+static int next_input(InputList* list, int worker) {
+  WorkDeque* own = &list->deques[worker];
+  int index = pop_input(own);
+
+  while (index < 0 && (take_unclaimed(list, worker) || steal_inputs(list, worker))) {
+    index = pop_input(own);
+  }
+
+  return index;
+}
+
+// Depth first, as a single thread walks them: the files of a directory come
+// before its subdirectories, and each of those in name order
+static int compare_walk_paths(const char* a, const char* b) {
+  for (;;) {
+    size_t a_len = strcspn(a, "/");
+    size_t b_len = strcspn(b, "/");
+    bool a_is_file = a[a_len] == '\0';
+    bool b_is_file = b[b_len] == '\0';
+
+    if (a_is_file != b_is_file) {
+      return a_is_file ? -1 : 1;
+    }
+
+    // Same as strcmp() on the names
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp == 0) {
+      cmp = (a_len > b_len) - (a_len < b_len);
+    }
+    if (cmp != 0 || a_is_file) {
+      return cmp;
+    }
+
+    a += a_len + 1;
+    b += b_len + 1;
+  }
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// One deque per thread that will claim inputs, worker 0 being the one that
+// waits for them with input_list_wait()
+InputList* input_list_create(int workers) {
+  InputList* list = calloc(1, sizeof(InputList));
+  if (!list) return NULL;
+
+  list->workers = workers > 0 ? workers : 1;
+  list->deques = calloc(list->workers, sizeof(WorkDeque));
+  if (!list->deques) {
+    free(list);
+    return NULL;
+  }
+
+  for (int i = 0; i < list->workers; i++) {
+    pthread_mutex_init(&list->deques[i].lock, NULL);
+  }
+  pthread_mutex_init(&list->lock, NULL);
+  pthread_cond_init(&list->changed, NULL);
+  arena_init(&list->paths, PATH_ARENA_BLOCK_SIZE);
+
+  return list;
+}
+
+// Someone will add inputs. The list ends when every producer closed it.
+void input_list_open(InputList* list) {
+  pthread_mutex_lock(&list->lock);
+  list->producers++;
+  pthread_mutex_unlock(&list->lock);
+}
+
+void input_list_close(InputList* list) {
+  pthread_mutex_lock(&list->lock);
+  list->producers--;
+  pthread_cond_broadcast(&list->changed);
+  pthread_mutex_unlock(&list->lock);
+}
+
+// Copies the path. Returns -1 if out of memory.
+int input_list_add(InputList* list, const char* path, size_t len, int source) {
+  int result = -1;
+
+  pthread_mutex_lock(&list->lock);
+
+  if (list->count == list->chunk_count * CHUNK_SIZE) {
+    ChunkTable* table = list->table;
+
+    if (table == NULL || list->chunk_count == table->capacity) {
+      int capacity = table ? table->capacity * 2 : 16;
+      ChunkTable* bigger = malloc(sizeof(ChunkTable) + sizeof(Input*) * capacity);
+      if (!bigger) goto unlock;
+
+      bigger->previous = table;
+      bigger->capacity = capacity;
+      if (table) {
+        memcpy(bigger->chunks, table->chunks, sizeof(Input*) * list->chunk_count);
+      }
+      __atomic_store_n(&list->table, bigger, __ATOMIC_RELEASE);
+      table = bigger;
+    }
+
+    Input* chunk = malloc(sizeof(Input) * CHUNK_SIZE);
+    if (!chunk) goto unlock;
+    table->chunks[list->chunk_count++] = chunk;
+  }
+
+  char* copy = arena_strndup(&list->paths, path, len);
+  if (!copy) goto unlock;
+
+  Input* input = input_at(list, list->count);
+  memset(input, 0, sizeof(Input));
+  input->path = copy;
+  input->source = source;
+  input->index = list->count++;
+  input->found = source != INPUT_NAMED && source != INPUT_LISTED;
+
+  pthread_cond_broadcast(&list->changed);
+  result = 0;
+
+unlock:
+  pthread_mutex_unlock(&list->lock);
+  return result;
+}
+
+// Next input for a worker to parse, waiting for one to be added. NULL once
+// all were claimed and no more are coming. Most come from the worker's own
+// deque, without taking the list lock.
+Input* input_list_claim(InputList* list, int worker) {
+  int index = pop_input(&list->deques[worker]);
+  if (index >= 0) {
+    return input_at(list, index);
+  }
+
+  pthread_mutex_lock(&list->lock);
+  while ((index = next_input(list, worker)) < 0 && list->producers > 0) {
+    pthread_cond_wait(&list->changed, &list->lock);
+  }
+  pthread_mutex_unlock(&list->lock);
+
+  return index >= 0 ? input_at(list, index) : NULL;
+}
+
+// A claimed input was parsed, result is never 0
+void input_list_parsed(InputList* list, Input* input, int result) {
+  pthread_mutex_lock(&list->lock);
+  input->result = result;
+  pthread_cond_broadcast(&list->changed);
+  pthread_mutex_unlock(&list->lock);
+}
+
+// Worker 0 waits for input index to be parsed and returns it. While it
+// isn't, inputs are handed out in *work to be parsed meanwhile, as by
+// input_list_claim(), returning NULL. NULL with no work means the list
+// ended before index.
+Input* input_list_wait(InputList* list, int index, Input** work) {
+  Input* input = NULL;
+  *work = NULL;
+
+  pthread_mutex_lock(&list->lock);
+
+  for (;;) {
+    if (index < list->count && input_at(list, index)->result != 0) {
+      input = input_at(list, index);
+      break;
+    }
+
+    int next = next_input(list, 0);
+    if (next >= 0) {
+      *work = input_at(list, next);
+      break;
+    }
+    if (index >= list->count && list->producers == 0) {
+      break;
+    }
+
+    pthread_cond_wait(&list->changed, &list->lock);
+  }
+
+  pthread_mutex_unlock(&list->lock);
+  return input;
+}
+
+// Only once nothing else is adding or parsing inputs
+Input* input_list_get(InputList* list, int index) {
+  return index >= 0 && index < list->count ? input_at(list, index) : NULL;
+}
+
+int input_list_count(InputList* list) {
+  pthread_mutex_lock(&list->lock);
+  int count = list->count;
+  pthread_mutex_unlock(&list->lock);
+
+  return count;
+}
+
+void input_list_destroy(InputList* list) {
+  if (!list) return;
+
+  ChunkTable* table = list->table;
+  for (int i = 0; i < list->chunk_count; i++) {
+    free(table->chunks[i]);
+  }
+  while (table) {
+    ChunkTable* previous = table->previous;
+    free(table);
+    table = previous;
+  }
+
+  for (int i = 0; i < list->workers; i++) {
+    pthread_mutex_destroy(&list->deques[i].lock);
+  }
+  free(list->deques);
+  arena_free(&list->paths);
+  pthread_cond_destroy(&list->changed);
+  pthread_mutex_destroy(&list->lock);
+  free(list);
+}
+
+// Order of two inputs regardless of when they were added, the one a single
+// thread would add: named files, the files found in each directory, then
+// the listed ones. Negative when a comes first.
+int input_order(const Input* a, const Input* b) {
+  if (a->source != b->source) {
+    return a->source < b->source ? -1 : 1;
+  }
+
+  // Only the walkers add in parallel
+  if (a->found) {
+    return compare_walk_paths(a->path, b->path);
+  }
+  return (a->index > b->index) - (a->index < b->index);
+}
@@ -0,0 +1,143 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "manifest.h"
+
+#define READ_SIZE (64 * 1024)
+
+struct Manifest {
+  InputList* list;
+  const char* path;
+  int fd;
+  int result;      // 0, or -1 if reading failed
+  int separator;   // -1 until the first path ends
+  pthread_t thread;
+};
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static size_t add_paths(Manifest* manifest, const char* buffer, size_t size);
+static void* manifest_main(void* arg);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Adds the complete paths in the buffer and returns how many bytes they took.
+// The first separator found, NUL or newline, is the only one from then on,
+// so NUL separated paths may have newlines in them.
+static size_t add_paths(Manifest* manifest, const char* buffer, size_t size) {
+  size_t start = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    char c = buffer[i];
+
+    if (c != '\0' && c != '\n') continue;
+
+    if (manifest->separator < 0) {
+      manifest->separator = c;
+    } else if (c != manifest->separator) {
+      continue;
+    }
+
+    // Empty paths, like the one after a trailing newline, are ignored
+    if (i > start && input_list_add(manifest->list, buffer + start, i - start, INPUT_LISTED) != 0) {
+      fprintf(stderr, "Error: cannot add file '%.*s'\n", (int)(i - start), buffer + start);
+    }
+    start = i + 1;
+  }
+
+  return start;
+}
+
+static void* manifest_main(void* arg) {
+  Manifest* manifest = arg;
+  size_t capacity = READ_SIZE;
+  size_t used = 0;
+  char* buffer = malloc(capacity);
+  ssize_t n = -1;
+
+  while (buffer != NULL) {
+    // A path longer than what is left makes room for itself
+    if (capacity - used < READ_SIZE / 2) {
+      char* bigger = realloc(buffer, capacity * 2);
+      if (!bigger) break;
+      buffer = bigger;
+      capacity *= 2;
+    }
+
+    n = read(manifest->fd, buffer + used, capacity - used);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+
+    used += (size_t)n;
+    size_t consumed = add_paths(manifest, buffer, used);
+    memmove(buffer, buffer + consumed, used - consumed);
+    used -= consumed;
+  }
+
+  if (n == 0) {
+    // The last path may have no separator after it
+    if (used > 0 && input_list_add(manifest->list, buffer, used, INPUT_LISTED) != 0) {
+      fprintf(stderr, "Error: cannot add file '%.*s'\n", (int)used, buffer);
+    }
+  } else {
+    fprintf(stderr, "Error: cannot read file list '%s'\n", manifest->path);
+    manifest->result = -1;
+  }
+
+  free(buffer);
+  input_list_close(manifest->list);
+  return NULL;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// NULL if the file can't be opened, the list is left as it was
+Manifest* manifest_start(InputList* list, const char* path) {
+  Manifest* manifest = calloc(1, sizeof(Manifest));
+  if (!manifest) return NULL;
+
+  manifest->list = list;
+  manifest->path = path;
+  manifest->separator = -1;
+  manifest->fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+
+  if (manifest->fd < 0) {
+    fprintf(stderr, "Error: cannot read file list '%s'\n", path);
+    free(manifest);
+    return NULL;
+  }
+
+  input_list_open(list);
+  if (pthread_create(&manifest->thread, NULL, manifest_main, manifest) != 0) {
+    input_list_close(list);
+    if (manifest->fd != STDIN_FILENO) close(manifest->fd);
+    free(manifest);
+    return NULL;
+  }
+
+  return manifest;
+}
+
+// Waits for the whole list to be read and frees the manifest. Returns -1 if
+// reading failed, 0 otherwise.
+int manifest_join(Manifest* manifest) {
+  if (!manifest) return 0;
+
+  pthread_join(manifest->thread, NULL);
+  int result = manifest->result;
+
+  if (manifest->fd != STDIN_FILENO) close(manifest->fd);
+  free(manifest);
+  return result;
+}
@@ -0,0 +1,182 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L // For writev
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "output.h"
+#include "stats.h"
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define TOMATO "🍅"
+#define TOMATO_LENGTH (sizeof(TOMATO) - 1)
+#define TOMATO_RUN 64
+#define TOMATO_4 TOMATO TOMATO TOMATO TOMATO
+#define TOMATO_16 TOMATO_4 TOMATO_4 TOMATO_4 TOMATO_4
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+typedef struct {
+  int fd;
+  size_t used;
+  char buffer[OUTPUT_BUFFER_SIZE];
+} Output;
+
+static Output standard_output = {STDOUT_FILENO, 0, {0}};
+static __thread Output* redirected = NULL; // This thread's, see output_redirect()
+
+static const char tomatoes[] = TOMATO_16 TOMATO_16 TOMATO_16 TOMATO_16;
+
+static Output* current(void);
+static void write_all(Output* out, struct iovec* iov, int count);
+static void output_padded(long long n, int width);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+static Output* current(void) {
+  return redirected ? redirected : &standard_output;
+}
+
+// Retries short writes. Errors drop the output, like a failed printf() would.
+static void write_all(Output* out, struct iovec* iov, int count) {
+  while (count > 0) {
+    ssize_t written = writev(out->fd, iov, count);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+
+    STATS_ADD(bytes_written, written);
+    while (count > 0 && (size_t)written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char*)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+}
+
+// Same as printf("%.*lld", width, n)
+static void output_padded(long long n, int width) {
+  char digits[24];
+  int length = 0;
+  unsigned long long value = n < 0 ? 0ull - (unsigned long long)n : (unsigned long long)n;
+
+  do {
+    digits[length++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (length < width) {
+    digits[length++] = '0';
+  }
+  if (n < 0) {
+    digits[length++] = '-';
+  }
+
+  Output* out = current();
+  if (out->used + length > OUTPUT_BUFFER_SIZE) {
+    output_flush();
+  }
+  while (length > 0) {
+    out->buffer[out->used++] = digits[--length];
+  }
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+void output_write(const char* data, size_t len) {
+  Output* out = current();
+  if (out->used + len <= OUTPUT_BUFFER_SIZE) {
+    memcpy(out->buffer + out->used, data, len);
+    out->used += len;
+    return;
+  }
+
+  // Too big to fit, send both in one call
+  struct iovec iov[2] = {
+    {out->buffer, out->used},
+    {(void*)data, len}
+  };
+  write_all(out, iov, 2);
+  out->used = 0;
+}
+
+void output_string(const char* str) {
+  output_write(str, strlen(str));
+}
+
+void output_char(char c) {
+  Output* out = current();
+  if (out->used == OUTPUT_BUFFER_SIZE) {
+    output_flush();
+  }
+  out->buffer[out->used++] = c;
+}
+
+void output_int(int n) {
+  output_padded(n, 1);
+}
+
+void output_long(long long n) {
+  output_padded(n, 1);
+}
+
+void output_minutes(long long minutes) {
+  if (minutes / 60 > 0) {
+    output_long(minutes / 60);
+    output_char('h');
+
+    if (minutes % 60 > 0) {
+      output_padded(minutes % 60, 2);
+      output_write("min", 3);
+    }
+  } else {
+    output_padded(minutes, 2);
+    output_write("min", 3);
+  }
+}
+
+// Copied from a precomputed run instead of one glyph at a time
+void output_tomatoes(int count) {
+  while (count > 0) {
+    int run = count < TOMATO_RUN ? count : TOMATO_RUN;
+    output_write(tomatoes, run * TOMATO_LENGTH);
+    count -= run;
+  }
+}
+
+void output_flush(void) {
+  Output* out = current();
+  struct iovec iov = {out->buffer, out->used};
+  write_all(out, &iov, 1);
+  out->used = 0;
+}
+
+// Sends what the calling thread outputs to fd instead of stdout, until it
+// calls it again with -1, which flushes. Returns -1 if out of memory.
+int output_redirect(int fd) {
+  if (redirected != NULL) {
+    output_flush();
+    free(redirected);
+    redirected = NULL;
+  }
+
+  if (fd >= 0) {
+    redirected = malloc(sizeof(Output));
+    if (redirected == NULL) return -1;
+
+    redirected->fd = fd;
+    redirected->used = 0;
+  }
+  return 0;
+}
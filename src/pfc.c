@@ -0,0 +1,449 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _XOPEN_SOURCE 700 // For realpath
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "hashmap.h"
+#include "pfc.h"
+
+// File layout, integers in the byte order of the machine that wrote it:
+//
+//   "PFC" version(u8)
+//   string count(u32), then the strings, each ending in NUL
+//   record count(u32), then for each record:
+//     path(u32) date(i64) pomodoro duration(i32)
+//     dependency count(u32), then path(u32) mtime(i64) size(i64) each
+//     count count(u32), then subject(u32) pomodoros(i32) each
+//
+// Paths and subjects are indexes into the strings.
+#define PFC_MAGIC "PFC"
+#define PFC_VERSION 2
+
+struct PfcCache {
+  char* path;
+  char* data;         // Contents of the cache file, loaded records point into it
+  HashMap* records;   // Resolved path -> PfcRecord*
+  pthread_rwlock_t lock; // Records are put while others are looked up
+  Arena arena;        // Records and their arrays
+  bool changed;       // Must be saved
+};
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+// Bounds checked cursor over the contents of a cache file
+typedef struct {
+  const char* data;
+  size_t length;
+  size_t offset;
+  bool failed;
+} Cursor;
+
+// Strings of a cache file being written
+typedef struct {
+  HashMap* indexes;   // String -> index + 1
+  const char** list;
+  int count;
+  int capacity;
+  bool failed;        // Out of memory, the file can't be written
+} StringTable;
+
+typedef struct {
+  FILE* file;
+  StringTable* strings;
+} RecordWriter;
+
+static char* read_whole_file(const char* path, size_t* length);
+static bool read_bytes(Cursor* cursor, void* value, size_t size);
+static uint32_t read_u32(Cursor* cursor);
+static int64_t read_i64(Cursor* cursor);
+static const char* read_string_ref(Cursor* cursor, const char** strings, uint32_t string_count);
+static bool load_records(PfcCache* cache, const char* data, size_t length);
+
+static uint32_t string_index(StringTable* table, const char* string);
+static void collect_strings(const char* key, void* value, void* table);
+static void write_u32(FILE* file, uint32_t value);
+static void write_i32(FILE* file, int32_t value);
+static void write_i64(FILE* file, int64_t value);
+static void write_record(const char* key, void* value, void* user_data);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// NULL with errno ENOENT if the file doesn't exist
+static char* read_whole_file(const char* path, size_t* length) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+
+  char* data = NULL;
+  long size;
+  if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+    data = malloc(size > 0 ? size : 1);
+    if (data != NULL && fread(data, 1, size, file) != (size_t)size) {
+      free(data);
+      data = NULL;
+    }
+    *length = size;
+  }
+
+  fclose(file);
+  return data;
+}
+
+static bool read_bytes(Cursor* cursor, void* value, size_t size) {
+  if (cursor->failed || cursor->length - cursor->offset < size) {
+    cursor->failed = true;
+    memset(value, 0, size);
+    return false;
+  }
+
+  memcpy(value, cursor->data + cursor->offset, size);
+  cursor->offset += size;
+  return true;
+}
+
+static uint32_t read_u32(Cursor* cursor) {
+  uint32_t value;
+  read_bytes(cursor, &value, sizeof(value));
+  return value;
+}
+
+static int64_t read_i64(Cursor* cursor) {
+  int64_t value;
+  read_bytes(cursor, &value, sizeof(value));
+  return value;
+}
+
+static const char* read_string_ref(Cursor* cursor, const char** strings, uint32_t string_count) {
+  uint32_t index = read_u32(cursor);
+
+  if (index >= string_count) {
+    cursor->failed = true;
+    return NULL;
+  }
+
+  return strings[index];
+}
+
+// Builds the records of a cache file, pointing into its data
+static bool load_records(PfcCache* cache, const char* data, size_t length) {
+  Cursor cursor = {data, length, 0, false};
+  char magic[sizeof(PFC_MAGIC)];
+
+  if (!read_bytes(&cursor, magic, sizeof(magic)) || memcmp(magic, PFC_MAGIC, sizeof(PFC_MAGIC) - 1) != 0 ||
+      magic[sizeof(PFC_MAGIC) - 1] != PFC_VERSION) {
+    return false;
+  }
+
+  uint32_t string_count = read_u32(&cursor);
+  if (cursor.failed || string_count > length) return false;
+
+  const char** strings = arena_alloc(&cache->arena, sizeof(char*) * (string_count + 1));
+  if (strings == NULL) return false;
+
+  for (uint32_t i = 0; i < string_count; i++) {
+    const char* start = data + cursor.offset;
+    const char* end = memchr(start, '\0', length - cursor.offset);
+    if (end == NULL) return false;
+
+    strings[i] = start;
+    cursor.offset += end - start + 1;
+  }
+
+  uint32_t record_count = read_u32(&cursor);
+
+  for (uint32_t r = 0; r < record_count && !cursor.failed; r++) {
+    PfcRecord* record = arena_alloc(&cache->arena, sizeof(PfcRecord));
+    if (record == NULL) return false;
+
+    const char* path = read_string_ref(&cursor, strings, string_count);
+    record->date = (int)read_i64(&cursor);
+    int32_t duration;
+    read_bytes(&cursor, &duration, sizeof(duration));
+    record->pomodoro_duration = duration;
+
+    uint32_t dependency_count = read_u32(&cursor);
+    if (cursor.failed || dependency_count > length) return false;
+
+    FileStamp* dependencies = arena_alloc(&cache->arena, sizeof(FileStamp) * (dependency_count + 1));
+    if (dependencies == NULL) return false;
+
+    for (uint32_t i = 0; i < dependency_count; i++) {
+      dependencies[i].path = (char*)read_string_ref(&cursor, strings, string_count);
+      dependencies[i].mtime = read_i64(&cursor);
+      dependencies[i].size = read_i64(&cursor);
+    }
+
+    uint32_t count_count = read_u32(&cursor);
+    if (cursor.failed || count_count > length) return false;
+
+    PfcCount* counts = arena_alloc(&cache->arena, sizeof(PfcCount) * (count_count + 1));
+    if (counts == NULL) return false;
+
+    for (uint32_t i = 0; i < count_count; i++) {
+      counts[i].subject = read_string_ref(&cursor, strings, string_count);
+      int32_t pomodoros;
+      read_bytes(&cursor, &pomodoros, sizeof(pomodoros));
+      counts[i].pomodoros = pomodoros;
+    }
+
+    record->dependencies = dependencies;
+    record->dependency_count = dependency_count;
+    record->counts = counts;
+    record->count_count = count_count;
+
+    if (!cursor.failed) {
+      hashmap_put(cache->records, path, record);
+    }
+  }
+
+  return !cursor.failed;
+}
+
+static uint32_t string_index(StringTable* table, const char* string) {
+  void* index = hashmap_get(table->indexes, string);
+  if (index != NULL) {
+    return (uint32_t)((uintptr_t)index - 1);
+  }
+
+  if (table->count == table->capacity) {
+    int capacity = table->capacity > 0 ? table->capacity * 2 : 256;
+    const char** list = realloc(table->list, sizeof(char*) * capacity);
+    if (list == NULL) {
+      table->failed = true;
+      return 0;
+    }
+
+    table->list = list;
+    table->capacity = capacity;
+  }
+
+  table->list[table->count] = string;
+  hashmap_put(table->indexes, string, (void*)(uintptr_t)(table->count + 1));
+  return table->count++;
+}
+
+static void collect_strings(const char* key, void* value, void* table) {
+  PfcRecord* record = (PfcRecord*)value;
+  StringTable* strings = (StringTable*)table;
+
+  string_index(strings, key);
+  for (int i = 0; i < record->dependency_count; i++) {
+    string_index(strings, record->dependencies[i].path);
+  }
+  for (int i = 0; i < record->count_count; i++) {
+    string_index(strings, record->counts[i].subject);
+  }
+}
+
+static void write_u32(FILE* file, uint32_t value) {
+  fwrite(&value, sizeof(value), 1, file);
+}
+
+static void write_i32(FILE* file, int32_t value) {
+  fwrite(&value, sizeof(value), 1, file);
+}
+
+static void write_i64(FILE* file, int64_t value) {
+  fwrite(&value, sizeof(value), 1, file);
+}
+
+static void write_record(const char* key, void* value, void* user_data) {
+  PfcRecord* record = (PfcRecord*)value;
+  RecordWriter* writer = (RecordWriter*)user_data;
+  FILE* file = writer->file;
+
+  write_u32(file, string_index(writer->strings, key));
+  write_i64(file, (int64_t)record->date);
+  write_i32(file, record->pomodoro_duration);
+
+  write_u32(file, record->dependency_count);
+  for (int i = 0; i < record->dependency_count; i++) {
+    write_u32(file, string_index(writer->strings, record->dependencies[i].path));
+    write_i64(file, record->dependencies[i].mtime);
+    write_i64(file, record->dependencies[i].size);
+  }
+
+  write_u32(file, record->count_count);
+  for (int i = 0; i < record->count_count; i++) {
+    write_u32(file, string_index(writer->strings, record->counts[i].subject));
+    write_i32(file, record->counts[i].pomodoros);
+  }
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// Loads the cache file at path. A missing or unreadable file gives an empty
+// cache, written there when saved.
+PfcCache* pfc_cache_open(const char* path) {
+  PfcCache* cache = malloc(sizeof(PfcCache));
+  if (cache == NULL) return NULL;
+
+  cache->path = malloc(strlen(path) + 1);
+  cache->records = hashmap_create(1024, 0.75);
+  cache->data = NULL;
+  cache->changed = false;
+  pthread_rwlock_init(&cache->lock, NULL);
+  arena_init(&cache->arena, 64 * 1024);
+
+  if (cache->path == NULL || cache->records == NULL) {
+    pfc_cache_close(cache);
+    return NULL;
+  }
+  strcpy(cache->path, path);
+
+  size_t length = 0;
+  errno = 0;
+  cache->data = read_whole_file(path, &length);
+
+  if (cache->data == NULL) {
+    if (errno != ENOENT) {
+      fprintf(stderr, "Warning: cannot read cache file '%s', starting a new one\n", path);
+    }
+  } else if (!load_records(cache, cache->data, length)) {
+    fprintf(stderr, "Warning: ignoring invalid cache file '%s'\n", path);
+
+    // Keep none of it
+    hashmap_destroy(cache->records, NULL);
+    arena_free(&cache->arena);
+    cache->records = hashmap_create(1024, 0.75);
+    cache->changed = true;
+    if (cache->records == NULL) {
+      pfc_cache_close(cache);
+      return NULL;
+    }
+  }
+
+  return cache;
+}
+
+// Record of a file, if the file and its includes didn't change since it was
+// put. Safe to call from several threads, also while records are put: those
+// are never freed, only replaced.
+const PfcRecord* pfc_cache_find(PfcCache* cache, const char* path) {
+  char resolved_path[PATH_MAX];
+
+  if (cache == NULL || realpath(path, resolved_path) == NULL) {
+    return NULL;
+  }
+
+  pthread_rwlock_rdlock(&cache->lock);
+  const PfcRecord* record = hashmap_get(cache->records, resolved_path);
+  pthread_rwlock_unlock(&cache->lock);
+  if (record == NULL) {
+    return NULL;
+  }
+
+  for (int i = 0; i < record->dependency_count; i++) {
+    if (!file_stamp_is_current(&record->dependencies[i])) {
+      return NULL;
+    }
+  }
+
+  return record;
+}
+
+// Copies a record to the cache, replacing the one of the same file. Records
+// are put by one thread at a time.
+void pfc_cache_put(PfcCache* cache, const PfcRecord* record) {
+  if (cache == NULL || record->dependency_count == 0) return;
+
+  PfcRecord* copy = arena_alloc(&cache->arena, sizeof(PfcRecord));
+  FileStamp* dependencies = arena_alloc(&cache->arena, sizeof(FileStamp) * record->dependency_count);
+  PfcCount* counts = arena_alloc(&cache->arena, sizeof(PfcCount) * (record->count_count + 1));
+  if (copy == NULL || dependencies == NULL || counts == NULL) return;
+
+  for (int i = 0; i < record->dependency_count; i++) {
+    dependencies[i] = record->dependencies[i];
+    const char* dependency_path = record->dependencies[i].path;
+    dependencies[i].path = arena_strndup(&cache->arena, dependency_path, strlen(dependency_path));
+    if (dependencies[i].path == NULL) return;
+  }
+
+  for (int i = 0; i < record->count_count; i++) {
+    counts[i].subject = arena_strndup(&cache->arena, record->counts[i].subject, strlen(record->counts[i].subject));
+    counts[i].pomodoros = record->counts[i].pomodoros;
+    if (counts[i].subject == NULL) return;
+  }
+
+  *copy = *record;
+  copy->dependencies = dependencies;
+  copy->counts = counts;
+
+  // Keyed by the file itself
+  pthread_rwlock_wrlock(&cache->lock);
+  hashmap_put(cache->records, dependencies[0].path, copy);
+  pthread_rwlock_unlock(&cache->lock);
+  cache->changed = true;
+}
+
+// Writes the cache file if anything was put. The new file replaces the old
+// one only once it's complete.
+int pfc_cache_save(PfcCache* cache) {
+  if (cache == NULL || !cache->changed) return 0;
+
+  StringTable strings = {hashmap_create(1024, 0.75), NULL, 0, 0, false};
+  if (strings.indexes == NULL) return -1;
+  hashmap_foreach(cache->records, collect_strings, &strings);
+
+  size_t tmp_len = strlen(cache->path) + 5;
+  char* tmp_path = malloc(tmp_len);
+  FILE* file = NULL;
+  int result = -1;
+
+  if (tmp_path != NULL && !strings.failed) {
+    snprintf(tmp_path, tmp_len, "%s.tmp", cache->path);
+    file = fopen(tmp_path, "wb");
+  }
+
+  if (file != NULL) {
+    char magic[sizeof(PFC_MAGIC)] = PFC_MAGIC;
+    magic[sizeof(PFC_MAGIC) - 1] = PFC_VERSION;
+    fwrite(magic, sizeof(magic), 1, file);
+
+    write_u32(file, strings.count);
+    for (int i = 0; i < strings.count; i++) {
+      fwrite(strings.list[i], strlen(strings.list[i]) + 1, 1, file);
+    }
+
+    RecordWriter writer = {file, &strings};
+    write_u32(file, hashmap_size(cache->records));
+    hashmap_foreach(cache->records, write_record, &writer);
+
+    bool failed = ferror(file) != 0;
+    if (fclose(file) == 0 && !failed && rename(tmp_path, cache->path) == 0) {
+      cache->changed = false;
+      result = 0;
+    } else {
+      remove(tmp_path);
+    }
+  }
+
+  if (result != 0) {
+    fprintf(stderr, "Error: cannot write cache file '%s'\n", cache->path);
+  }
+
+  free(tmp_path);
+  free(strings.list);
+  hashmap_destroy(strings.indexes, NULL);
+  return result;
+}
+
+void pfc_cache_close(PfcCache* cache) {
+  if (cache == NULL) return;
+
+  hashmap_destroy(cache->records, NULL);
+  pthread_rwlock_destroy(&cache->lock);
+  arena_free(&cache->arena);
+  free(cache->data);
+  free(cache->path);
+  free(cache);
+}
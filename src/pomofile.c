@@ -4,7 +4,9 @@
  * 
  * See LICENSE file for full BSD 3-Clause license terms.
  */
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,40 +16,101 @@
 #include "pomofile.h"
 #include "preprocessor.h"
 #include "process_data.h"
+#include "registers.h"
+#include "day_index.h"
+#include "scan.h"
+#include "pfc.h"
+#include "stats.h"
+#include "subjects.h"
 
 /* -------------------------- AUXILIARY FUNCTIONS DECLARATIONS -------------------------------- */
 
+#define FILE_ARENA_BLOCK_SIZE 1024
+#define MAX_LINE_POMODOROS 9999 // Already more than a day's worth
+
+// Parsed include made only of assignments, shared by the files including it
+typedef struct {
+  HashMap* assignments;
+  Arena arena; // Assignment values
+} IncludeTable;
+
+// Totals of --summary, indexed by subject id
+typedef struct {
+  long long* pomodoros;
+  long long* minutes;
+  bool* seen;
+  ProcessData* process_data;
+} Summary;
+
+// A date being exported
+typedef struct {
+  const Exporter* exporter;
+  const char* date;
+  int pomodoro_duration;
+} DateRows;
+
 static void print(const char* key, void* value, void* type);
+static int duration_of_date(HashMap* pomodoro_durations, const char* date);
+static void print_register(const char* subj, int pomodoros_ammount, void* user_data);
 //static void print_registers_on_date(const char* key, void* val, void* user_data);
-static int merge_pomodoros_counters(HashMap* old_counters, HashMap* updated_counters);
-static int search_abbvr(HashMap* assignments, HashMap* registers);
-static char* minutes_to_time(int minutes);
-static void process_register(const char* subj, void* pomodoros_ammount, void* pomodoro_duration);
-static void process_register_to_html(const char* subj, void* pomodoros_ammount, void* pomodoro_duration);
-
-static int read_assignment(char* line, HashMap* assignments);
-static int read_register(char* line, HashMap* registers);
-static LineType classify_line(char* line);
-
-static bool is_pomodoro_duration_defined(HashMap* assignments);
-static bool is_date_defined(HashMap* assignments);
-
-static int get_pomodoro_duration(HashMap* assignments);
-static time_t get_date(HashMap* assignments);
-
-static void filter_after_before_date(time_t after_date, time_t before_date, HashMap* global_registers, HashMap* filtered_registers) ;
-static void filter_after_date(time_t after_date, HashMap* global_registers, HashMap* filtered_registers);
-static void filter_before_date(time_t before_date, HashMap* global_registers, HashMap* filtered_registers);
+static void export_register(const char* subj, int pomodoros_ammount, void* date_rows);
+
+static int read_assignment(const char* line, size_t len, const LineScan* scan,
+                           HashMap* assignments, Arena* arena);
+static int read_register(const char* line, size_t len, const LineScan* scan,
+                         PomoFile* pomofile, HashMap* subject_set);
+static int count_pomodoros(const char* value, size_t len);
+static LineType classify_line(const LineScan* scan);
+static bool split_view(const char* line, size_t len, size_t at, int count,
+                       const char** left, size_t* left_len,
+                       const char** right, size_t* right_len);
+
+static void* get_assignment(PomoFile* pomofile, const char* key, size_t len);
+static bool use_shared_assignments(const void* table, void* pomofile);
+static void* parse_include_table(PomoReader* reader);
+static void free_include_table(void* table);
+static void copy_assignment(const char* key, void* value, void* assignments);
+
+static bool is_pomodoro_duration_defined(PomoFile* pomofile);
+static bool is_date_defined(PomoFile* pomofile);
+
+static int get_pomodoro_duration(PomoFile* pomofile);
+static int get_date(PomoFile* pomofile);
+static int resolve_date(PomoFile* pomofile);
+static bool is_out_of_range(RegisterFilter* filter, int day);
+static bool find_range(ProcessData* process_data, int* first, int* end);
+static void release_assignments(PomoFile* pomofile);
+
+static bool is_listed_subject(int subject, void* subject_set);
+static void add_to_summary(const char* date, void* registers, void* summary);
+static int compare_subject_ids(const void* a, const void* b);
+static void update_rollups(ProcessData* process_data, int day, RegisterMap* registers, int sign, int minutes);
+static int add_days(ProcessData* process_data, int first_day, int last_day, RollupTable* table);
+static int add_period_part(ProcessData* process_data, Period period, int first_day, int last_day, RollupTable* table);
+static int compare_total_subjects(const void* a, const void* b);
+static void print_period(ProcessData* process_data, Period period, int number, RollupTable* table, RollupTotal** totals);
+
+static bool load_cached(PomoFile* pomofile, PfcCache* pfc_cache, bool track_dependencies);
+static void keep_dependencies(PomoFile* pomofile, const FileStamp* dependencies, int count);
+static void add_count(const char* subject, int pomodoros, void* record);
+static void store_cached(PomoFile* pomofile, PfcCache* pfc_cache);
 
 /* ---------------------------------- AUXILIARY FUNCTIONS ------------------------------------ */
 
 static void print(const char* key, void* value, void* type) {
-  if (strcmp("ASSIGNMENT", (const char*)type) == 0) {
-    printf("\"%s\":\"%s\",\n", key, (char*)value);
-  } else {
-    int pomodoros_ammount = string_to_int((char*)value);
-    printf("\"%s\":\"%d\",\n", key, pomodoros_ammount);
-  }
+  (void)type;
+  printf("\"%s\":\"%s\",\n", key, (char*)value);
+}
+
+// Durations are kept as integers in the pointers, so setting one again
+// never allocates
+static int duration_of_date(HashMap* pomodoro_durations, const char* date) {
+  return (int)(intptr_t)hashmap_get(pomodoro_durations, date);
+}
+
+static void print_register(const char* subj, int pomodoros_ammount, void* user_data) {
+  (void)user_data;
+  printf("\"%s\":\"%d\",\n", subj, pomodoros_ammount);
 }
 
 
@@ -61,162 +124,196 @@ static void print(const char* key, void* value, void* type) {
 */
 
 
-static int merge_pomodoros_counters(HashMap* old_counters, HashMap* updated_counters) {
-  if (!old_counters || !updated_counters ) return 0;
-  int added_elements = 0;
-  for (int i = 0; i < updated_counters->capacity; i++) {
-    Entry* entry = updated_counters->buckets[i];
-    while (entry) {
-      int current_value = string_to_int(hashmap_get(old_counters, entry->key));
-
-      if (current_value) {
-        int new_value = current_value + string_to_int(entry->value);
-        hashmap_put(old_counters, entry->key, int_to_string(new_value));
-      } else {
-        hashmap_put(old_counters, entry->key, entry->value);
-        added_elements++;
-      }
-      entry = entry->next;
-    }
-  }
-  return added_elements;
+static void export_register(const char* subj, int pomodoros_ammount, void* date_rows) {
+  DateRows* rows = (DateRows*)date_rows;
+  rows->exporter->row(rows->date, subj, pomodoros_ammount, (long long)pomodoros_ammount * rows->pomodoro_duration);
 }
 
-static int search_abbvr(HashMap* assignments, HashMap* registers) {
-  if (!assignments || !registers) return 0;
-  int modified = 0;
-  for (int i = 0; i < registers->capacity; i++) {
-    Entry* entry = registers->buckets[i];
-    while (entry) {
-      void* found_assignment = hashmap_get(assignments, entry->key);
+static LineType classify_line(const LineScan* scan) {
+  if (scan->equal_count > 0 && scan->colon_count == 0) {
+    return LINE_ASSIGNMENT;
+  }
 
-      if (found_assignment) {
-        entry->key = (char*)found_assignment;
-        modified++;
-      }
+  if (scan->equal_count == 0 && scan->colon_count > 0) {
+    return LINE_REGISTER;
+  } 
 
-      entry = entry->next;
-    }
-  }
+  return LINE_INVALID;
+}
+
+// Splits a line at offset at, where the delimiter was found count times
+// by scan_line(). Returns false if it doesn't appear exactly once.
+static bool split_view(const char* line, size_t len, size_t at, int count,
+                       const char** left, size_t* left_len,
+                       const char** right, size_t* right_len) {
+  if (count != 1) return false;
 
-  return modified;
+  const char* rest = line + at + 1;
+  size_t rest_len = len - at - 1;
+
+  *left_len = at;
+  *left = trim_view(line, left_len);
+  *right_len = rest_len;
+  *right = trim_view(rest, right_len);
+  return true;
 }
 
-static char* minutes_to_time(int minutes) {
-  char* buffer = malloc(80 * sizeof(char));
+static int read_assignment(const char* line, size_t len, const LineScan* scan,
+                           HashMap* assignments, Arena* arena) {
+  const char *abbreviation, *name;
+  size_t abbreviation_len, name_len;
 
-  if (minutes / 60 > 0) {
-    if (minutes % 60 > 0) {
-      sprintf(buffer,"%dh%.2dmin", minutes / 60, minutes % 60);
-    } else {
-      sprintf(buffer, "%dh", minutes /60);
-    }
+  if (split_view(line, len, scan->equal, scan->equal_count,
+                 &abbreviation, &abbreviation_len, &name, &name_len)) {
+    char* subject_name = string_from_view(arena, name, name_len);
 
-  } else {
-    sprintf(buffer,"%.2dmin", minutes);
+    hashmap_put_len(assignments, abbreviation, abbreviation_len, subject_name);
+
+    return 1;
   }
 
-  return buffer;
+  return 0;
 }
 
-static void process_register(const char* subj, void* pomodoros_ammount, void* pomodoro_duration) {
-  printf("%s:\n", subj);
-  int p_ammount = string_to_int(pomodoros_ammount);
-  int duration = *(int*)pomodoro_duration;
-  for (int i = 0; i < p_ammount; i++) {
-    printf("🍅");
+// Pomodoros of a register: its stars, or a count written as "40" or "*x40".
+// -1 past MAX_LINE_POMODOROS.
+static int count_pomodoros(const char* value, size_t len) {
+  const char* digits = value;
+  size_t digits_len = len;
+
+  if (len > 2 && value[0] == '*' && value[1] == 'x') {
+    digits += 2;
+    digits_len -= 2;
   }
-  printf(" -> %s\n", minutes_to_time(duration * p_ammount));
-}
 
-static void process_register_to_html(const char* subj, void* pomodoros_ammount, void* pomodoro_duration) {
-  int p_ammount = string_to_int(pomodoros_ammount);
-  int duration = *(int*)pomodoro_duration;
+  // Up to 9 digits, so it can't overflow before the limit is checked
+  if (digits_len > 0 && digits_len <= 9) {
+    int count = 0;
+    size_t i = 0;
+
+    while (i < digits_len && digits[i] >= '0' && digits[i] <= '9') {
+      count = count * 10 + (digits[i++] - '0');
+    }
+    if (i == digits_len) {
+      return count <= MAX_LINE_POMODOROS ? count : -1;
+    }
+  }
 
-  printf("    <tr>\n"
-         "     <td class=\"subject\">%s</td>\n"
-         "     <td class=\"tomato\">",
-         subj);
-              for (int i = 0; i < p_ammount; i++) {
-                printf("🍅");
-              }
-         printf("</td>\n"
-         "     <td class=\"time\">%s</td>\n"
-         "    </tr>\n", minutes_to_time(p_ammount * duration)
-         );
+  int count = scan_count_stars(value, len);
+  return count <= MAX_LINE_POMODOROS ? count : -1;
 }
 
-static LineType classify_line(char *line) {
-  // Skips initial whitespaces
-  line = trim_left(line);
-  
-  char* has_equal = strchr(line, '=');
-  char* has_colon = strchr(line, ':');
+// Counts the pomodoros of a register under the full subject name.
+// Abbreviations must be assigned before the registers that use them.
+// Subjects missing from subject_set, when there's one, are skipped.
+// Returns -1 when the count or the subject's total is too big.
+static int read_register(const char* line, size_t len, const LineScan* scan,
+                         PomoFile* pomofile, HashMap* subject_set) {
+  const char *subject, *stars;
+  size_t subject_len, stars_len;
+
+  if (split_view(line, len, scan->colon, scan->colon_count,
+                 &subject, &subject_len, &stars, &stars_len)) {
+    const char* subject_name = get_assignment(pomofile, subject, subject_len);
+
+    if (subject_name) {
+      subject = subject_name;
+      subject_len = strlen(subject_name);
+    }
 
-  if (has_equal && !has_colon) {
-    return LINE_ASSIGNMENT;
-  }
+    if (subject_set && !hashmap_get_len(subject_set, subject, subject_len)) {
+      return 1;
+    }
 
-  if (!has_equal && has_colon) {
-    return LINE_REGISTER;
-  } 
+    int pomodoros = count_pomodoros(stars, stars_len);
+    if (pomodoros < 0 || register_map_add(pomofile->registers, subject_intern(subject, subject_len), pomodoros) != 0) {
+      return -1;
+    }
 
-  return LINE_INVALID;
+    return 1;
+  }
+
+  return 0;
 }
 
-static int read_assignment(char* line, HashMap* assignments) {
-  int parts_count;
-  char** parts = split_string(line, '=', &parts_count);
+// Own assignments first, then the ones shared from an include
+static void* get_assignment(PomoFile* pomofile, const char* key, size_t len) {
+  void* value = hashmap_get_len(pomofile->assignments, key, len);
 
-  if (parts && parts_count == 2) {
-    char* subject_name_abbreviation = strip_string(parts[0], NULL);
-    char* subject_name = strip_string(parts[1], NULL);
+  if (value == NULL && pomofile->shared_assignments != NULL) {
+    value = hashmap_get_len(pomofile->shared_assignments, key, len);
+  }
 
-    hashmap_put(assignments, subject_name_abbreviation, subject_name);
-    free_string_array(parts);
+  return value;
+}
 
-    return 1;
+static void copy_assignment(const char* key, void* value, void* assignments) {
+  hashmap_put((HashMap*)assignments, key, value);
+}
+
+// Called by the preprocessor with the parsed assignments of an include
+static bool use_shared_assignments(const void* table, void* pomofile) {
+  PomoFile* file = (PomoFile*)pomofile;
+  HashMap* assignments = ((const IncludeTable*)table)->assignments;
+
+  if (file->shared_assignments == NULL && hashmap_size(file->assignments) == 0) {
+    file->shared_assignments = assignments;
+  } else {
+    // Only one table can be shared and it must stay older than any own
+    // assignment, the rest is copied over
+    hashmap_foreach(assignments, copy_assignment, file->assignments);
   }
 
-  free_string_array(parts);
-  return 0;
+  return true;
 }
 
-static int read_register(char *line, HashMap *registers) {
-  int parts_count;
-  char** parts = split_string(line, ':', &parts_count);
-  
-  if (parts && parts_count == 2) {
-    char* subject = strip_string(parts[0], NULL);
-    char* stars_string = strip_string(parts[1], NULL);
-
-    // If it exists, update its value
-    if (hashmap_get(registers, subject) != NULL) {
-      int old_pomodoros_ammount = string_to_int(hashmap_get(registers, subject));
-      int current_pomodoros_ammount = count_stars(stars_string);
-      int updated_pomodoros_ammount = old_pomodoros_ammount + current_pomodoros_ammount;
-      hashmap_put(registers, subject, int_to_string(updated_pomodoros_ammount));
-    } else {
-      // If not, create it
-      hashmap_put(registers, subject, int_to_string(count_stars(stars_string)));
+// Parses an include made only of assignments. Anything else is left to
+// parse_file() through the include's lines.
+static void* parse_include_table(PomoReader* reader) {
+  IncludeTable* table = malloc(sizeof(IncludeTable));
+  if (!table) return NULL;
+
+  table->assignments = hashmap_create(16, 0.75);
+  arena_init(&table->arena, 0);
+  if (!table->assignments) {
+    free(table);
+    return NULL;
+  }
+
+  const char* line;
+  size_t len;
+  while ((line = reader_next_line(reader, &len)) != NULL) {
+    LineScan scan;
+    scan_line(line, len, &scan);
+    if (scan.blank) {
+      continue;
     }
 
-    free_string_array(parts);
-    return 1;
+    if (classify_line(&scan) != LINE_ASSIGNMENT) {
+      free_include_table(table);
+      return NULL;
+    }
+    read_assignment(line, len, &scan, table->assignments, &table->arena);
   }
 
-  free_string_array(parts);
-  return 0;
+  return table;
 }
 
-static bool is_pomodoro_duration_defined(HashMap* assignments) {
-  bool exists = hashmap_contains(assignments, "POMO");
+static void free_include_table(void* table) {
+  IncludeTable* include_table = (IncludeTable*)table;
 
-  if (!exists) {
+  hashmap_destroy(include_table->assignments, NULL);
+  arena_free(&include_table->arena);
+  free(include_table);
+}
+
+static bool is_pomodoro_duration_defined(PomoFile* pomofile) {
+  char* val = (char*)get_assignment(pomofile, "POMO", 4);
+
+  if (val == NULL) {
     return false;
   }
 
-  char* val = (char*)hashmap_get(assignments, "POMO");
   int minutes = string_to_int(val);
 
   if (minutes != 0) {
@@ -226,149 +323,281 @@ static bool is_pomodoro_duration_defined(HashMap* assignments) {
   return false;
 }
 
-static int get_pomodoro_duration(HashMap *assignments) {
-  int minutes = string_to_int(hashmap_get(assignments, "POMO"));
+static int get_pomodoro_duration(PomoFile* pomofile) {
+  int minutes = string_to_int(get_assignment(pomofile, "POMO", 4));
 
   return minutes;
 }
 
-static bool is_date_defined(HashMap* assignments) {
-  bool exists = hashmap_contains(assignments, "DATE");
+static bool is_date_defined(PomoFile* pomofile) {
+  char* date = (char*)get_assignment(pomofile, "DATE", 4);
 
-  if (!exists) {
+  if (date == NULL) {
     return false;
   }
 
-  char* date = (char*)hashmap_get(assignments, "DATE");
-  if (string_to_time(date) == -1) {
+  if (string_to_day(date) == DAY_INVALID) {
     return false;
   }
 
   return true;
 }
 
-static time_t get_date(HashMap* assignments) {
-  char* date = hashmap_get(assignments, "DATE");
-  return string_to_time(date);
+static int get_date(PomoFile* pomofile) {
+  char* date = get_assignment(pomofile, "DATE", 4);
+  return string_to_day(date);
 }
 
+// DATE, or the modification date when there's none. Only then is the file
+// stat()ed, once.
+static int resolve_date(PomoFile* pomofile) {
+  if (is_date_defined(pomofile)) {
+    return get_date(pomofile);
+  }
 
+  if (pomofile->date == DAY_INVALID) {
+    pomofile->date = time_to_day(get_file_mod_date(pomofile->path));
+  }
+  return pomofile->date;
+}
 
-static void filter_after_before_date(time_t after_date, time_t before_date, HashMap* global_registers, HashMap* filtered_registers) {
-  HashMapIterator* iter = hashmap_iterator_create(global_registers);
+// Assignments are only needed while parsing
+static void release_assignments(PomoFile* pomofile) {
+  hashmap_destroy(pomofile->assignments, NULL);
+  pomofile->assignments = NULL;
+  pomofile->shared_assignments = NULL;
+  arena_free(&pomofile->arena);
+}
 
-  do {
-    const char* key = hashmap_iterator_key(iter);
-    void* val = hashmap_iterator_value(iter);
-    time_t current_date = string_to_time(key);
+// Both ends are excluded
+static bool is_out_of_range(RegisterFilter* filter, int day) {
+  return (filter->aftdate_flag && day <= filter->after_date) ||
+         (filter->befdate_flag && day >= filter->before_date);
+}
 
-    if (current_date > after_date && current_date < before_date) {
-      hashmap_put(filtered_registers, key, val);
-    }
-  } while (hashmap_iterator_next(iter));
+// Positions [first, end) of the dates inside -a and -b in the day index,
+// found with binary searches. Returns false when there's none.
+static bool find_range(ProcessData* process_data, int* first, int* end) {
+  RegisterFilter* register_filter = &process_data->register_filter;
+  DayIndex* day_index = &process_data->day_index;
+
+  day_index_sort(day_index);
+  *first = 0;
+  *end = day_index->size;
+
+  if (register_filter->aftdate_flag || register_filter->befdate_flag) {
+    int first_day = register_filter->aftdate_flag ? register_filter->after_date + 1 : INT_MIN;
+    int last_day = register_filter->befdate_flag ? register_filter->before_date - 1 : INT_MAX;
+    *first = day_index_lower_bound(day_index, first_day);
+    *end = last_day == INT_MAX ? day_index->size : day_index_lower_bound(day_index, last_day + 1);
+  }
 
-  hashmap_iterator_destroy(iter);
+  return *first < *end;
 }
 
 
-static void filter_after_date(time_t after_date, HashMap* global_registers, HashMap* filtered_registers) {
-  HashMapIterator* iter = hashmap_iterator_create(global_registers);
 
-  do {
-    const char* key = hashmap_iterator_key(iter);
-    void* val = hashmap_iterator_value(iter);
-    time_t current_date = string_to_time(key);
+// Adds a date's registers to the per-subject totals, indexed by subject id
+static void add_to_summary(const char* date, void* registers, void* summary) {
+  Summary* totals = (Summary*)summary;
+  RegisterMap* map = (RegisterMap*)registers;
+  int pomodoro_duration = duration_of_date(totals->process_data->pomodoro_durations, date);
 
-    if (current_date > after_date) {
-      hashmap_put(filtered_registers, key, val);
-    }
-  } while (hashmap_iterator_next(iter));
+  for (int i = 0; i < map->capacity; i++) {
+    Register* reg = &map->slots[i];
+    if (reg->subject == -1) continue;
+
+    totals->pomodoros[reg->subject] += reg->pomodoros;
+    totals->minutes[reg->subject] += (long long)reg->pomodoros * pomodoro_duration;
+    totals->seen[reg->subject] = true;
+  }
+}
+
+static int compare_subject_ids(const void* a, const void* b) {
+  return strcmp(subject_name(*(const int*)a), subject_name(*(const int*)b));
+}
+
+static bool is_listed_subject(int subject, void* subject_set) {
+  return hashmap_get((HashMap*)subject_set, subject_name(subject)) != NULL;
+}
+
+// See rollups_add(), only when --by was given
+static void update_rollups(ProcessData* process_data, int day, RegisterMap* registers, int sign, int minutes) {
+  if (process_data->rollups == NULL) return;
 
-  hashmap_iterator_destroy(iter);
+  if (rollups_add(process_data->rollups, day, registers, sign, minutes) != 0) {
+    fprintf(stderr, "Error: cannot update the totals per period\n");
+  }
 }
 
+// Adds the registers of the dates in [first_day, last_day] to table, each
+// counted with its own pomodoro duration
+static int add_days(ProcessData* process_data, int first_day, int last_day, RollupTable* table) {
+  DayIndex* day_index = &process_data->day_index;
 
-static void filter_before_date(time_t before_date, HashMap* global_registers, HashMap* filtered_registers) {
-  HashMapIterator* iter = hashmap_iterator_create(global_registers);
+  for (int i = day_index_lower_bound(day_index, first_day);
+       i < day_index->size && day_index->days[i].day <= last_day; i++) {
+    DayEntry* entry = &day_index->days[i];
+    int pomodoro_duration = duration_of_date(process_data->pomodoro_durations, entry->date);
 
-  do {
-    const char* key = hashmap_iterator_key(iter);
-    void* val = hashmap_iterator_value(iter);
-    time_t current_date = string_to_time(key);
+    for (int j = 0; j < entry->registers->capacity; j++) {
+      Register* reg = &entry->registers->slots[j];
+      if (reg->subject == -1) continue;
 
-    if (current_date < before_date) {
-      hashmap_put(filtered_registers, key, val);
+      if (rollup_table_add(table, reg->subject, reg->lines, reg->pomodoros,
+                           (long long)reg->pomodoros * pomodoro_duration) != 0) {
+        return -1;
+      }
     }
-  } while (hashmap_iterator_next(iter));
+  }
 
-  hashmap_iterator_destroy(iter);
+  return 0;
 }
 
+// Adds the totals of [first_day, last_day], inside a single period, to
+// table. They come from the period's rollup when it's whole, otherwise
+// from the months of a year and the days of what's left.
+static int add_period_part(ProcessData* process_data, Period period, int first_day, int last_day, RollupTable* table) {
+  int number = period_number(period, first_day);
 
-static int remove_subjects_not_in(HashMap* registers, char** subjects) {
-  if (!registers || !subjects) return 0;
-  int removed_elements = 0;
+  if (first_day == period_first_day(period, number) && last_day == period_first_day(period, number + 1) - 1) {
+    const RollupTable* totals = rollups_get(process_data->rollups, period, number);
+    return totals != NULL ? rollup_table_merge(table, totals) : 0;
+  }
 
-  for (int i = 0;  i < registers->capacity; i++) {
-    Entry* entry = registers->buckets[i];
-    Entry* prev = NULL;
+  if (period != PERIOD_YEAR) {
+    return add_days(process_data, first_day, last_day, table);
+  }
 
-    while (entry) {
-      const char* subject = entry->key;
-      if (!string_arr_contains(subjects, subject)) {
-        Entry* to_remove = entry;
-        Entry* next = entry->next;
+  for (int month = period_number(PERIOD_MONTH, first_day); month <= period_number(PERIOD_MONTH, last_day); month++) {
+    int month_first = period_first_day(PERIOD_MONTH, month);
+    int month_last = period_first_day(PERIOD_MONTH, month + 1) - 1;
 
-        if (prev) {
-          prev->next = next;
-        } else {
-          registers->buckets[i] = next;
-        }
+    if (add_period_part(process_data, PERIOD_MONTH, month_first > first_day ? month_first : first_day,
+                        month_last < last_day ? month_last : last_day, table) != 0) {
+      return -1;
+    }
+  }
 
-        free(to_remove->key);
-        free(to_remove);
+  return 0;
+}
 
-        registers->size--;
-        removed_elements++;
+static int compare_total_subjects(const void* a, const void* b) {
+  return strcmp(subject_name((*(RollupTotal* const*)a)->subject), subject_name((*(RollupTotal* const*)b)->subject));
+}
 
-        entry = next;
-      } else {
-        prev = entry;
-        entry = entry->next;
-      }
+// Exports the subjects of table with register lines, by name. totals has
+// room for all of them.
+static void print_period(ProcessData* process_data, Period period, int number, RollupTable* table, RollupTotal** totals) {
+  int n = 0;
+  for (int i = 0; i < table->capacity; i++) {
+    if (table->slots[i].subject != -1 && table->slots[i].lines > 0) {
+      totals[n++] = &table->slots[i];
     }
   }
+  if (n == 0) return;
+  qsort(totals, n, sizeof(RollupTotal*), compare_total_subjects);
 
-  return removed_elements;
+  char label[PERIOD_STRING_SIZE];
+  const Exporter* exporter = process_data->exporter;
+  period_to_string(period, number, label);
+
+  exporter->begin_period(label);
+  for (int i = 0; i < n; i++) {
+    exporter->period_row(label, subject_name(totals[i]->subject), totals[i]->pomodoros, totals[i]->minutes);
+  }
+  exporter->end_period();
 }
 
 
-static void filter_subjects(HashMap* global_registers, HashMap* filtered_registers, char** subjects) {
-  HashMapIterator* iter = hashmap_iterator_create(global_registers);
-  do {
-    const char* date = hashmap_iterator_key(iter);
-    HashMap* registers = hashmap_iterator_value(iter);
+// Fills the file from its .pfc record, if it's still valid
+static bool load_cached(PomoFile* pomofile, PfcCache* pfc_cache, bool track_dependencies) {
+  const PfcRecord* record = pfc_cache_find(pfc_cache, pomofile->path);
+  if (record == NULL) {
+    return false;
+  }
+
+  for (int i = 0; i < record->count_count; i++) {
+    const char* subject = record->counts[i].subject;
+    register_map_add(pomofile->registers, subject_intern(subject, strlen(subject)), record->counts[i].pomodoros);
+  }
 
-    remove_subjects_not_in(registers, subjects);
-    hashmap_put(filtered_registers, date, registers);
+  pomofile->date = record->date;
+  pomofile->pomodoro_duration = record->pomodoro_duration;
+  pomofile->cached = true;
 
-  } while(hashmap_iterator_next(iter));
+  if (track_dependencies) {
+    keep_dependencies(pomofile, record->dependencies, record->dependency_count);
+  }
+  return true;
 }
 
+// Copies the stamps and their paths in a single block, it outlives the merge
+static void keep_dependencies(PomoFile* pomofile, const FileStamp* dependencies, int count) {
+  size_t size = sizeof(FileStamp) * count;
+  for (int i = 0; i < count; i++) {
+    size += strlen(dependencies[i].path) + 1;
+  }
+
+  free(pomofile->dependencies);
+  pomofile->dependencies = malloc(size > 0 ? size : 1);
+  pomofile->dependency_count = 0;
+  if (pomofile->dependencies == NULL) return;
+
+  char* paths = (char*)(pomofile->dependencies + count);
+  for (int i = 0; i < count; i++) {
+    size_t path_len = strlen(dependencies[i].path) + 1;
+
+    pomofile->dependencies[i] = dependencies[i];
+    pomofile->dependencies[i].path = memcpy(paths, dependencies[i].path, path_len);
+    paths += path_len;
+  }
+  pomofile->dependency_count = count;
+}
+
+static void add_count(const char* subject, int pomodoros, void* record) {
+  PfcRecord* pfc_record = (PfcRecord*)record;
+  PfcCount* counts = (PfcCount*)pfc_record->counts;
+
+  counts[pfc_record->count_count].subject = subject;
+  counts[pfc_record->count_count].pomodoros = pomodoros;
+  pfc_record->count_count++;
+}
+
+// Records what parsing the file produced, before any filter
+static void store_cached(PomoFile* pomofile, PfcCache* pfc_cache) {
+  PfcRecord record;
+  record.date = pomofile->date;
+  record.pomodoro_duration = pomofile->pomodoro_duration;
+  record.dependencies = pomofile->dependencies;
+  record.dependency_count = pomofile->dependency_count;
+  record.counts = arena_alloc(&pomofile->arena, sizeof(PfcCount) * (register_map_size(pomofile->registers) + 1));
+  record.count_count = 0;
+
+  if (record.counts != NULL && record.dependency_count > 0) {
+    register_map_foreach(pomofile->registers, add_count, &record);
+    pfc_cache_put(pfc_cache, &record);
+  }
+}
 
 /* ---------------------------------- AUXILIARY FUNCTIONS END ---------------------------------- */
 
 int pomofile_init(PomoFile* file, const char* path) {
   file->path = path;
   file->assignments = hashmap_create(16, 0.75);
-  file->registers = hashmap_create(16, 0.75);
+  file->registers = register_map_create(16, 0.75);
+  file->shared_assignments = NULL;
+  file->dependencies = NULL;
+  file->dependency_count = 0;
+  file->cached = false;
+  arena_init(&file->arena, FILE_ARENA_BLOCK_SIZE);
 
   if (!file->assignments || !file->registers) {
     free_pomofile(file);
     return -1;
   }
 
-  file->date = get_file_mod_date(path);
+  file->date = DAY_INVALID; // Worked out while parsing
   file->pomodoro_duration = 30;
   return 0;
 }
@@ -381,6 +610,9 @@ void print_pomofile(PomoFile* pomofile) {
   printf("Assignments: ");
   if (pomofile->assignments != NULL) {
     printf("{\n   ");
+    if (pomofile->shared_assignments != NULL) {
+      hashmap_foreach(pomofile->shared_assignments, print, "ASSIGNMENT");
+    }
     hashmap_foreach(pomofile->assignments, print, "ASSIGNMENT");
     printf("\n}\n");
   } else {
@@ -389,12 +621,13 @@ void print_pomofile(PomoFile* pomofile) {
   printf("Registers: ");
   if (pomofile->registers != NULL) {
     printf("{\n   ");
-    hashmap_foreach(pomofile->registers, print, "REGISTER");
+    register_map_foreach(pomofile->registers, print_register, NULL);
     printf("\n}\n");
   } else {
     printf("NONE\n");
   }
-  printf("Date: %s\n", time_to_string(pomofile->date));
+  char date[DATE_STRING_SIZE];
+  printf("Date: %s\n", day_to_string(pomofile->date, date));
   printf("Pomodoro duration: %d\n", pomofile->pomodoro_duration);
   printf("----------------------------------------------\n");
 }
@@ -406,124 +639,340 @@ void free_pomofile(PomoFile* pomofile) {
   if (pomofile->assignments) {
     hashmap_destroy(pomofile->assignments, NULL);
   }
+  arena_free(&pomofile->arena);
+  free(pomofile->dependencies);
   if (pomofile->registers) {
-    hashmap_destroy(pomofile->registers, NULL);
+    register_map_destroy(pomofile->registers);
   }
 
   pomofile->path = NULL;
-  pomofile->date = -1;
+  pomofile->date = DAY_INVALID;
   pomofile->pomodoro_duration = 0;
   pomofile->assignments = NULL;
+  pomofile->shared_assignments = NULL;
   pomofile->registers = NULL;
+  pomofile->dependencies = NULL;
+  pomofile->dependency_count = 0;
 }
 
-int parse_file(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data) {
-  FILE* f = preprocess_file(pomofile->path, 0);
-  if (f == NULL) {
+IncludeCache* pomofile_create_include_cache(void) {
+  return include_cache_create(parse_include_table, free_include_table);
+}
+
+// Set of subjects for read_register(), NULL if it can't be created
+HashMap* pomofile_create_subject_set(char** subjects) {
+  HashMap* subject_set = hashmap_create(16, 0.75);
+  if (!subject_set) return NULL;
+
+  for (int i = 0; subjects && subjects[i] != NULL; i++) {
+    hashmap_put(subject_set, subjects[i], subjects[i]);
+  }
+
+  return subject_set;
+}
+
+int pomofile_parse(PomoFile* pomofile, ProcessData* process_data) {
+  PfcCache* pfc_cache = process_data->pfc_cache;
+  if (pfc_cache != NULL && load_cached(pomofile, pfc_cache, process_data->track_dependencies)) {
+    return 1;
+  }
+
+  // A cached record must serve any -s, so every subject is counted and the
+  // filter waits for the merge
+  HashMap* subject_set = pfc_cache ? NULL : process_data->register_filter.subject_set;
+
+  PomoReader* reader = reader_open(pomofile->path, process_data->include_cache, process_data->map_files,
+                                   use_shared_assignments, pomofile);
+  if (reader == NULL) {
     fprintf(stderr, "Erro: cannot read file '%s'\n", pomofile->path);
     return -1;
   }
 
-  char line[1024];
-  int line_n = 0;
-  while (fgets(line, sizeof(line), f) != NULL) {
-    line[strcspn(line, "\n")] = '\0';
-    line_n++;
-
-    if (is_empty_str(line)) {
+  // The configuration usually ends at the file's first task, so the date is
+  // known there. Out of range, the tasks aren't worth reading. Without a
+  // DATE yet, one may still come after the tasks, so the file is read whole.
+  bool date_checked = !process_data->skip_out_of_range;
+  int result = 1;
+
+  const char* line;
+  size_t len;
+  while ((line = reader_next_line(reader, &len)) != NULL) {
+    LineScan scan;
+    scan_line(line, len, &scan);
+    if (scan.blank) {
       continue;
     }
     
-    LineType t = classify_line(line);
+    LineType t = classify_line(&scan);
 
     if (t == LINE_ASSIGNMENT) {
-      read_assignment(line, pomofile->assignments);
+      read_assignment(line, len, &scan, pomofile->assignments, &pomofile->arena);
     }
     if (t == LINE_REGISTER) {
-      read_register(line, pomofile->registers);
+      if (!date_checked && reader_depth(reader) == 0) {
+        date_checked = true;
+        if (is_date_defined(pomofile) &&
+            is_out_of_range(&process_data->register_filter, get_date(pomofile))) {
+          STATS_ADD(files_out_of_range, 1);
+          result = POMOFILE_OUT_OF_RANGE;
+          break;
+        }
+      }
+      if (read_register(line, len, &scan, pomofile, subject_set) < 0) {
+        fprintf(stderr, "Error: too many pomodoros at %s:%d\n", reader_path(reader), reader_line_number(reader));
+        reader_close(reader);
+        return -1;
+      }
     }
     if (t == LINE_INVALID) {
-      fprintf(stderr, "Error: invalid line at %s:%d\n", pomofile->path, line_n);
-      fclose(f); 
+      fprintf(stderr, "Error: invalid line at %s:%d\n", reader_path(reader), reader_line_number(reader));
+      reader_close(reader);
       return -1;
     }
   }
 
-  if (is_pomodoro_duration_defined(pomofile->assignments)) {
-    pomofile->pomodoro_duration = get_pomodoro_duration(pomofile->assignments);
+  if (is_pomodoro_duration_defined(pomofile)) {
+    pomofile->pomodoro_duration = get_pomodoro_duration(pomofile);
+  }
+  pomofile->date = resolve_date(pomofile);
+
+  // Kept for skipped files too, -w reads them again when they change
+  if (process_data->track_dependencies) {
+    keep_dependencies(pomofile, reader_dependencies(reader), reader_dependency_count(reader));
   }
-  if (is_date_defined(pomofile->assignments)) {
-    pomofile->date = get_date(pomofile->assignments);
+
+  reader_close(reader);
+  if (result == POMOFILE_OUT_OF_RANGE) {
+    release_assignments(pomofile);
   }
+  return result;
+}
 
-  search_abbvr(pomofile->assignments, pomofile->registers);
+// Adds the registers of an already parsed file to the global ones.
+// Not thread safe: files must be merged one at a time, in input order.
+void pomofile_merge(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data) {
+  if (process_data->pfc_cache != NULL) {
+    if (!pomofile->cached) {
+      store_cached(pomofile, process_data->pfc_cache);
+    }
 
-  // If there's no entry in global registers, create new
-  if (hashmap_get(global_registers, time_to_string(pomofile->date)) == NULL) {
-    hashmap_put(global_registers, time_to_string(pomofile->date), (void*)pomofile->registers);
-  } else {
-    // If it already exists, update it
-    HashMap* old_counters = hashmap_get(global_registers, time_to_string(pomofile->date)); 
-    HashMap* updated_counters = pomofile->registers;
+    HashMap* subject_set = process_data->register_filter.subject_set;
+    if (subject_set != NULL) {
+      register_map_retain(pomofile->registers, is_listed_subject, subject_set);
+    }
+  }
 
-    merge_pomodoros_counters(old_counters, updated_counters);
+  char date[DATE_STRING_SIZE];
+  day_to_string(pomofile->date, date);
+  RegisterMap* counters = hashmap_get(global_registers, date);
+
+  // If there's no entry in global registers, create new. It's never the
+  // file's own map, so what the file added can be taken back.
+  if (counters == NULL) {
+    counters = register_map_create(16, 0.75);
+    if (counters == NULL) {
+      fprintf(stderr, "Error: cannot merge file '%s'\n", pomofile->path);
+      return;
+    }
+
+    // The index keeps the string, the maps copy their keys. A date missing
+    // from the index would be left out of every report.
+    if (day_index_add(&process_data->day_index, pomofile->date,
+                      string_from_view(&process_data->arena, date, strlen(date)), counters) != 0) {
+      fprintf(stderr, "Error: cannot merge file '%s'\n", pomofile->path);
+      register_map_destroy(counters);
+      return;
+    }
+    hashmap_put(global_registers, date, counters);
   }
 
-  // Pomodoro duration for that day
-  hashmap_put(process_data->pomodoro_durations, time_to_string(pomofile->date), int_to_string(pomofile->pomodoro_duration));
+  // Pomodoro duration for that day, before the file's pomodoros count
+  // with it
+  pomofile_set_duration(process_data, pomofile->date, pomofile->pomodoro_duration);
+
+  int created = register_map_merge(counters, pomofile->registers);
+  STATS_ADD(registers_created, created);
+  STATS_ADD(registers_merged, register_map_size(pomofile->registers));
+  update_rollups(process_data, pomofile->date, pomofile->registers, 1, pomofile->pomodoro_duration);
 
-  fclose(f); 
-  return 1;
+  release_assignments(pomofile);
+}
+
+// Takes back the registers pomofile_merge() added for the file. The
+// pomodoro duration of its date is left as it is.
+void pomofile_unmerge(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data) {
+  char date[DATE_STRING_SIZE];
+  RegisterMap* counters = hashmap_get(global_registers, day_to_string(pomofile->date, date));
+  if (counters != NULL) {
+    register_map_subtract(counters, pomofile->registers);
+
+    int pomodoro_duration = duration_of_date(process_data->pomodoro_durations, date);
+    update_rollups(process_data, pomofile->date, pomofile->registers, -1, -pomodoro_duration);
+  }
+}
+
+// Sets the pomodoro duration of a day, recounting the minutes its
+// registers add to the totals per period
+void pomofile_set_duration(ProcessData* process_data, int day, int pomodoro_duration) {
+  char date[DATE_STRING_SIZE];
+  day_to_string(day, date);
+
+  if (process_data->rollups != NULL) {
+    RegisterMap* registers = hashmap_get(process_data->global_registers, date);
+    // A date has its duration before any register, so the registers of a
+    // new one are empty
+    int change = pomodoro_duration - duration_of_date(process_data->pomodoro_durations, date);
+
+    if (registers != NULL && change != 0) {
+      update_rollups(process_data, day, registers, 0, change);
+    }
+  }
+
+  hashmap_put(process_data->pomodoro_durations, date, (void*)(intptr_t)pomodoro_duration);
+}
+
+int parse_file(PomoFile* pomofile, HashMap* global_registers, ProcessData* process_data) {
+  int result = pomofile_parse(pomofile, process_data);
+
+  if (result == 1) {
+    pomofile_merge(pomofile, global_registers, process_data);
+  }
+
+  return result;
 }
 
 void process_final_registers(const char* date, void* registers, void* process_data) {
   ProcessData* proc_data = (ProcessData*)process_data;
-  RegisterFilter register_filter = proc_data->register_filter;
 
   HashMap* pomodoro_durations = proc_data->pomodoro_durations;
-  int pomodoro_duration = string_to_int(hashmap_get(pomodoro_durations, date));
-  
+  int pomodoro_duration = duration_of_date(pomodoro_durations, date);
+
   // A file not empty
-  if (hashmap_size(registers) > 0) {
-    // Export
-    if (register_filter.export_flag) {
-      //to HTML
-      if (strcmp(register_filter.export_type, "html") == 0) {
-        print_table_top_part(date, minutes_to_time(pomodoro_duration));
-        hashmap_foreach((HashMap*)registers, process_register_to_html, &pomodoro_duration);
-        print_table_down_part();
+  if (register_map_size(registers) > 0) {
+    DateRows rows = {proc_data->exporter, date, pomodoro_duration};
+
+    proc_data->exporter->begin_date(date, pomodoro_duration);
+    register_map_foreach((RegisterMap*)registers, export_register, &rows);
+    proc_data->exporter->end_date();
+  }
+}
+
+// Pomodoros and minutes of each subject over all dates in registers, each
+// date counted with its own pomodoro duration
+void print_summary(ProcessData* process_data, int first, int end) {
+  int count = subject_count();
+  Summary summary = {
+    calloc(count + 1, sizeof(long long)),
+    calloc(count + 1, sizeof(long long)),
+    calloc(count + 1, sizeof(bool)),
+    process_data
+  };
+  int* subjects = malloc(sizeof(int) * (count + 1));
+
+  if (!summary.pomodoros || !summary.minutes || !summary.seen || !subjects) {
+    fprintf(stderr, "Error: cannot allocate the summary\n");
+  } else {
+    for (int i = first; i < end; i++) {
+      DayEntry* entry = &process_data->day_index.days[i];
+      add_to_summary(entry->date, entry->registers, &summary);
+    }
+
+    int n = 0;
+    for (int id = 0; id < count; id++) {
+      if (summary.seen[id]) {
+        subjects[n++] = id;
       }
-    // Normal output
-    } else {
-      printf("\nDate: %s - Pomodoro length: %d min\n", date, pomodoro_duration);
-      hashmap_foreach((HashMap*)registers, process_register, &pomodoro_duration);
     }
+    qsort(subjects, n, sizeof(int), compare_subject_ids);
+
+    const Exporter* exporter = process_data->exporter;
+    exporter->begin_summary();
+    for (int i = 0; i < n; i++) {
+      int id = subjects[i];
+      exporter->summary_row(subject_name(id), summary.pomodoros[id], summary.minutes[id]);
+    }
+    exporter->end_summary();
   }
+
+  free(summary.pomodoros);
+  free(summary.minutes);
+  free(summary.seen);
+  free(subjects);
 }
 
-void filter_registers(ProcessData* process_data, HashMap* filtered_registers) {
-  HashMap* global_registers = process_data->global_registers;
-  RegisterFilter register_filter = process_data->register_filter;
+// Totals of each week, month or year with dates in [first, end) of the day
+// index, latest first when reverse is set. Only the periods cut by -a or
+// -b add up days, the others come from the rollups.
+void print_periods(ProcessData* process_data, Period period, int first, int end, bool reverse) {
+  RegisterFilter* filter = &process_data->register_filter;
+  DayEntry* days = process_data->day_index.days;
+  RollupTable table = {NULL, 0, 0};
+  RollupTotal** totals = NULL;
+  const Exporter* exporter = process_data->exporter;
+
+  exporter->begin_periods();
+  if (first < end) {
+    // Days in range, even those without dates. When no date was in range,
+    // they are all printed.
+    int first_day = filter->aftdate_flag ? filter->after_date + 1 : INT_MIN;
+    int last_day = filter->befdate_flag ? filter->before_date - 1 : INT_MAX;
+    if (days[first].day < first_day || days[end - 1].day > last_day) {
+      first_day = INT_MIN;
+      last_day = INT_MAX;
+    }
+
+    int first_number = period_number(period, days[first].day);
+    int last_number = period_number(period, days[end - 1].day);
+    totals = malloc(sizeof(RollupTotal*) * (subject_count() + 1));
+    if (!totals) {
+      fprintf(stderr, "Error: cannot allocate the totals per period\n");
+    }
+
+    for (int i = 0; totals && i <= last_number - first_number; i++) {
+      int number = reverse ? last_number - i : first_number + i;
+      int period_first = period_first_day(period, number);
+      int period_last = period_first_day(period, number + 1) - 1;
 
-  if (register_filter.aftdate_flag && register_filter.befdate_flag) {
-    filter_after_before_date(register_filter.after_date,
-                             register_filter.before_date,
-                             global_registers,
-                             filtered_registers);
+      rollup_table_clear(&table);
+      if (add_period_part(process_data, period, period_first > first_day ? period_first : first_day,
+                          period_last < last_day ? period_last : last_day, &table) != 0) {
+        fprintf(stderr, "Error: cannot allocate the totals per period\n");
+        break;
+      }
+      print_period(process_data, period, number, &table, totals);
+    }
   }
-  else if (register_filter.aftdate_flag) {
-    filter_after_date(register_filter.after_date, global_registers, filtered_registers); }
-  else if (register_filter.befdate_flag) {
-    filter_before_date(register_filter.before_date, global_registers, filtered_registers);
+  exporter->end_periods();
+
+  rollup_table_free(&table);
+  free(totals);
+}
+
+// Positions [first, end) of the dates to print in the day index, sorted
+// by filtering. When none is in range they are all printed.
+void filter_registers(ProcessData* process_data, int* first, int* end) {
+  if (!find_range(process_data, first, end)) {
+    *first = 0;
+    *end = process_data->day_index.size;
   }
 
-  if (register_filter.subj_flag) {
-    if (hashmap_size(filtered_registers) != 0) {
-      filter_subjects(filtered_registers, filtered_registers, register_filter.subjects); 
-    } else {
-      filter_subjects(global_registers, filtered_registers, register_filter.subjects); 
-    }
+  // Subjects were already filtered while parsing
+}
+
+// Whether any date is inside -a and -b, sorting the day index
+bool has_dates_in_range(ProcessData* process_data) {
+  int first, end;
+  return find_range(process_data, &first, &end);
+}
+
+// Prints the dates in [first, end) of the day index, latest first when
+// reverse is set
+void print_dates(ProcessData* process_data, int first, int end, bool reverse) {
+  DayEntry* days = process_data->day_index.days;
+
+  for (int i = first; i < end; i++) {
+    DayEntry* entry = &days[reverse ? end - 1 - (i - first) : i];
+    process_final_registers(entry->date, entry->registers, process_data);
   }
-  
 }
 
@@ -4,19 +4,33 @@
  * 
  * See LICENSE file for full BSD 3-Clause license terms.
  */
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include "hashmap.h"
 #include "util.h"
 #include "pomofile.h"
 #include "export.h"
+#include "inputs.h"
+#include "walk.h"
+#include "manifest.h"
+#include "subjects.h"
+#include "watch.h"
+#include "output.h"
+#include "serve.h"
+#include "stats.h"
 
 /*---------- CONSTANTS AND MACROS --------------*/
 
 #define INITIAL_HASHMAP_SIZE 16
 #define LOAD_FACTOR 0.75
+#define RUN_ARENA_BLOCK_SIZE (64 * 1024)
 
 /*---------- OPTION HANDLING RELATED -------------*/
 
@@ -25,20 +39,32 @@ typedef struct {
   bool befdate_flag;
   bool subj_flag;
   bool export_flag;
-  time_t after_date;
-  time_t before_date;
+  int after_date;
+  int before_date;
   char** subjects;
-  char* export_type;
+  const Exporter* exporter;
+  int jobs;
+  char* cache_path;
+  bool watch_flag;
+  bool summary_flag;
+  char* manifest_path;
+  bool reverse_flag;
+  char* serve_path;
+  int by_period; // Period of --by, -1 without it
 } Options;
 
-static Options options = {false, false, false, false, -1, -1, NULL, NULL};
+static Options options = {false, false, false, false, DAY_INVALID, DAY_INVALID, NULL, NULL, 1, NULL, false, false, NULL, false, NULL, -1};
 
 /*---------- GLOBAL VARIABLES --------------*/
 
-static PomoFile* pomofiles_array = NULL;
-static HashMap* filtered_registers = NULL;
+static InputList* inputs = NULL;
+static Server* server = NULL;
 static ProcessData process_data;
 
+// Only when walking directories, to skip the files other files include
+static HashMap* included = NULL;      // Resolved path of every file included
+static HashMap* merged_found = NULL;  // Resolved path -> Input* merged
+
 /*------------------------------------------------*/
 
 /* Forward declarations */
@@ -47,58 +73,110 @@ static void clear_resources(void);
 static void usage(void);
 static int parse_options(int argc, char** argv);
 static void validade_date_range(void);
-static int initialize_pomofiles(int argc, int options_count);
-static void handle_initialization_error(int processed_count, const char* filename);
+static void initialize_pomofiles(int argc, int options_count);
+static int add_inputs(int argc, char** argv, int first, char*** dirs);
+static void parse_input(Input* input);
+static void* parse_worker(void* arg);
+static void note_includes(Input* input);
+static void merge_input(Input* input);
+static void set_last_duration(const char* date, void* value, void* user_data);
+static void resolve_durations(void);
+static void read_out_of_range(void);
+static void free_registers(void* registers);
+static void print_report(void);
+static void publish_report(void);
+static void serve(void);
 
 
 static void clear_resources(void) {
-  if (filtered_registers != NULL) {
-    hashmap_destroy(filtered_registers, NULL);
-    filtered_registers = NULL;
-  }
-
   if (process_data.global_registers != NULL) {
-    hashmap_destroy(process_data.global_registers, NULL);
+    hashmap_destroy(process_data.global_registers, free_registers);
     process_data.global_registers = NULL;
   }
 
+  day_index_free(&process_data.day_index);
+  rollups_destroy(process_data.rollups);
+  process_data.rollups = NULL;
+
+  if (process_data.include_cache != NULL) {
+    include_cache_destroy(process_data.include_cache);
+    process_data.include_cache = NULL;
+  }
+
+  if (process_data.pfc_cache != NULL) {
+    pfc_cache_close(process_data.pfc_cache);
+    process_data.pfc_cache = NULL;
+  }
+
+  subjects_free();
+  arena_free(&process_data.arena);
+
   if (process_data.pomodoro_durations != NULL) {
     hashmap_destroy(process_data.pomodoro_durations, NULL);
     process_data.pomodoro_durations = NULL;
   }
 
+  if (process_data.register_filter.subject_set != NULL) {
+    hashmap_destroy(process_data.register_filter.subject_set, NULL);
+    process_data.register_filter.subject_set = NULL;
+  }
+
   if (process_data.register_filter.subjects != NULL) {
     free_string_array(process_data.register_filter.subjects);
     process_data.register_filter.subjects = NULL;
   }
 
-  if (pomofiles_array != NULL) {
-    free(pomofiles_array);
-    pomofiles_array = NULL;
+  if (inputs != NULL) {
+    int count = input_list_count(inputs);
+    for (int i = 0; i < count; i++) {
+      free_pomofile(&input_list_get(inputs, i)->pomofile);
+    }
+    input_list_destroy(inputs);
+    inputs = NULL;
   }
 
+  hashmap_destroy(included, NULL);
+  hashmap_destroy(merged_found, NULL);
+  included = merged_found = NULL;
+
   process_data.register_filter.aftdate_flag = false;
   process_data.register_filter.befdate_flag = false;
   process_data.register_filter.subj_flag = false;
-  process_data.register_filter.export_flag = false;
-  process_data.register_filter.export_type = NULL;
-  process_data.register_filter.after_date = -1;
-  process_data.register_filter.before_date = -1;
+  process_data.exporter = NULL;
+  process_data.register_filter.after_date = DAY_INVALID;
+  process_data.register_filter.before_date = DAY_INVALID;
 }
 
 
 static void usage(void) {
   fprintf(stderr, "Pomofile Interpreter\n"
-                  "Usage: pomointer [OPTIONS] <pomofile1> <pomofile2> ... <pomofileN>\n\n"
+                  "Usage: pomointer [OPTIONS] <pomofile or directory> ...\n\n"
                   "Options:\n"
                   "  -h                            Show this help message\n"
                   "  -a \"%%d/%%m/%%Y\"                 Filter entries after this date\n"
                   "  -b \"%%d/%%m/%%Y\"                 Filter entries before this date\n"
                   "  -s subj1,subj2,...,subjN      Filter entries by subject\n"
-                  "  -e html                       Export to html file\n\n"
+                  "  -e html|csv|json|ndjson       Export in another format\n"
+                  "  -j N                          Parse files using N threads\n"
+                  "  -c cache.pfc                  Reuse files parsed in earlier runs\n"
+                  "  -f list|-                     Also read the files listed in list or stdin\n"
+                  "  -r                            Print the latest dates first\n"
+                  "  -w                            Print again whenever an input file changes\n"
+                  "  --serve socket                Answer queries on a Unix socket\n"
+                  "  --summary                     Print totals per subject instead of dates\n"
+                  "  --by week|month|year          Print totals per subject of each period\n"
+                  "  --stats                       Print timings and counters to stderr\n\n"
                   "Examples: \n"
                   "  pomointer -a \"16/01/2026\" -b \"31/01/2026\" pomofile1.pf pomofile2.pf\n"
                   "  pomointer -s \"Math,Physics\" -a \"05/03/2026\" -e \"html\" pomofile1.pf > index.html\n"
+                  "  pomointer -e ndjson archive/*.pf | jq .minutes\n"
+                  "  pomointer -j 8 archive/\n"
+                  "  pomointer -c ~/.cache/pomointer.pfc archive/*.pf\n"
+                  "  find archive -name '*.pf' -print0 | pomointer -f -\n"
+                  "  pomointer -w today.pf\n"
+                  "  pomointer --serve /tmp/pomointer.sock archive/\n"
+                  "  pomointer --summary -a \"31/12/2025\" -b \"01/04/2026\" archive/*.pf\n"
+                  "  pomointer --by month -a \"31/12/2020\" archive/\n"
                   );
   exit(EXIT_FAILURE);
 }
@@ -135,9 +213,9 @@ static int parse_options(int argc, char** argv) {
       }
 
       char* date_str = argv[i+1];
-      time_t parsed_date = string_to_time(date_str);
+      int parsed_date = string_to_day(date_str);
 
-      if (parsed_date == -1) {
+      if (parsed_date == DAY_INVALID) {
         fprintf(stderr, "Error: Invalid date format for option '%s'\n", opt);
         fprintf(stderr, "Expected format: \"DD/MM/YYYY\"\n");
         exit(EXIT_FAILURE);
@@ -161,7 +239,7 @@ static int parse_options(int argc, char** argv) {
       }
 
       int count;
-      char** subjects = split_string(argv[i+1], ',', &count);
+      char** subjects = split_string(NULL, argv[i+1], ',', &count);
 
       options.subj_flag = true;
       options.subjects = subjects;
@@ -170,17 +248,96 @@ static int parse_options(int argc, char** argv) {
       options_processed += 2; // Flag and date argument
     }
     else if (strcmp(opt, "-e") == 0) {
-      if (i + 1 >= argc || strcmp(argv[i+1], "html") != 0) {
+      if (i + 1 >= argc || exporter_find(argv[i+1]) == NULL) {
         fprintf(stderr, "Error: option %s requires a valid file type to export\n", opt);
         usage();
       }
 
       options.export_flag = true;
-      options.export_type = argv[i+1];
+      options.exporter = exporter_find(argv[i+1]);
       
       i++; // Skip the export type argument
       options_processed += 2; // Flag and export type
     }
+    else if (strcmp(opt, "-j") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Error: option %s requires a number of threads\n", opt);
+        usage();
+      }
+
+      char* endptr;
+      long jobs = strtol(argv[i+1], &endptr, 10);
+
+      if (endptr == argv[i+1] || *endptr != '\0' || jobs < 1 || jobs > 1024) {
+        fprintf(stderr, "Error: Invalid number of threads '%s'\n", argv[i+1]);
+        exit(EXIT_FAILURE);
+      }
+
+      options.jobs = (int)jobs;
+
+      i++; // Skip the number of threads
+      options_processed += 2; // Flag and number of threads
+    }
+    else if (strcmp(opt, "-c") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Error: option %s requires a cache file\n", opt);
+        usage();
+      }
+
+      options.cache_path = argv[i+1];
+
+      i++; // Skip the cache file
+      options_processed += 2; // Flag and cache file
+    }
+    else if (strcmp(opt, "-f") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Error: option %s requires a file listing the input files\n", opt);
+        usage();
+      }
+
+      options.manifest_path = argv[i+1];
+
+      i++; // Skip the file list
+      options_processed += 2; // Flag and file list
+    }
+    else if (strcmp(opt, "--summary") == 0) {
+      options.summary_flag = true;
+      options_processed++;
+    }
+    else if (strcmp(opt, "--by") == 0) {
+      if (i + 1 >= argc || period_find(argv[i+1]) == -1) {
+        fprintf(stderr, "Error: option %s requires week, month or year\n", opt);
+        usage();
+      }
+
+      options.by_period = period_find(argv[i+1]);
+
+      i++; // Skip the period
+      options_processed += 2; // Flag and period
+    }
+    else if (strcmp(opt, "--stats") == 0) {
+      stats.enabled = true;
+      options_processed++;
+    }
+    else if (strcmp(opt, "-r") == 0) {
+      options.reverse_flag = true;
+      options_processed++;
+    }
+    else if (strcmp(opt, "-w") == 0) {
+      options.watch_flag = true;
+      options_processed++;
+    }
+    else if (strcmp(opt, "--serve") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Error: option %s requires a socket path\n", opt);
+        usage();
+      }
+
+      options.serve_path = argv[i+1];
+
+      i++; // Skip the socket path
+      options_processed += 2; // Flag and socket path
+    }
     else {
       fprintf(stderr, "Error: Unknown option '%s'\n", opt);
       usage();
@@ -188,38 +345,50 @@ static int parse_options(int argc, char** argv) {
    }
 
 
-  validade_date_range();
-  return options_processed;
-}
-
+  // Each query brings its own
+  if (options.serve_path && (options.aftdate_flag || options.befdate_flag || options.subj_flag ||
+                             options.export_flag || options.reverse_flag || options.summary_flag ||
+                             options.watch_flag)) {
+    fprintf(stderr, "Error: --serve takes dates, subjects and formats from each query\n");
+    exit(EXIT_FAILURE);
+  }
 
-static void handle_initialization_error(int processed_count, const char* filename) {
-  for (int i = 0; i < processed_count; i++) {
-    free_pomofile(&pomofiles_array[i]);
+  if (options.by_period != -1 && (options.summary_flag || options.serve_path)) {
+    fprintf(stderr, "Error: --by can't be used with --summary or --serve\n");
+    exit(EXIT_FAILURE);
   }
-  clear_resources();
-  fprintf(stderr, "Error: Failed to initialize PomoFile for '%s'\n", filename);
-  exit(EXIT_FAILURE);
+
+  validade_date_range();
+  return options_processed;
 }
 
 
-static int initialize_pomofiles(int argc, int options_count) {
+static void initialize_pomofiles(int argc, int options_count) {
   int num_files = argc - 1 - options_count;
 
-  if (num_files <= 0) {
+  if (num_files <= 0 && options.manifest_path == NULL) {
     fprintf(stderr, "Error: No input files specified\n");
     usage();
   }
 
-  pomofiles_array = malloc(num_files * sizeof(PomoFile));
-  if (pomofiles_array == NULL) {
+  inputs = input_list_create(options.jobs);
+  if (inputs == NULL) {
     fprintf(stderr, "Error: Memory allocation failed to pomofiles array\n");
     exit(EXIT_FAILURE);
   }
 
-  filtered_registers = hashmap_create(INITIAL_HASHMAP_SIZE, LOAD_FACTOR);
   process_data.global_registers = hashmap_create(INITIAL_HASHMAP_SIZE, LOAD_FACTOR);
   process_data.pomodoro_durations = hashmap_create(INITIAL_HASHMAP_SIZE, LOAD_FACTOR);
+  process_data.include_cache = pomofile_create_include_cache();
+  day_index_init(&process_data.day_index);
+  process_data.rollups = options.by_period != -1 ? rollups_create() : NULL;
+  arena_init(&process_data.arena, RUN_ARENA_BLOCK_SIZE);
+  int subjects_result = subjects_init();
+  process_data.pfc_cache = options.cache_path ? pfc_cache_open(options.cache_path) : NULL;
+  process_data.track_dependencies = options.cache_path != NULL || options.watch_flag || options.serve_path != NULL;
+  process_data.map_files = !options.watch_flag && options.serve_path == NULL;
+  // Files read again after a change aren't looked at by read_out_of_range()
+  process_data.skip_out_of_range = (options.aftdate_flag || options.befdate_flag) && process_data.map_files;
 
   // Copy options to data processing structure
   process_data.register_filter.aftdate_flag = options.aftdate_flag;
@@ -228,19 +397,236 @@ static int initialize_pomofiles(int argc, int options_count) {
   process_data.register_filter.before_date = options.before_date;
   process_data.register_filter.subj_flag = options.subj_flag;
   process_data.register_filter.subjects = options.subjects;
-  process_data.register_filter.export_flag = options.export_flag;
-  process_data.register_filter.export_type = options.export_type;
+  process_data.register_filter.subject_set = NULL;
+  if (options.subj_flag) {
+    process_data.register_filter.subject_set = pomofile_create_subject_set(options.subjects);
+  }
+  process_data.exporter = options.export_flag ? options.exporter : exporter_find("text");
 
-  if (process_data.global_registers == NULL || process_data.pomodoro_durations == NULL) {
+  if (process_data.global_registers == NULL || process_data.pomodoro_durations == NULL ||
+      process_data.include_cache == NULL || subjects_result != 0 ||
+      (options.subj_flag && process_data.register_filter.subject_set == NULL) ||
+      (options.cache_path && process_data.pfc_cache == NULL) ||
+      (options.by_period != -1 && process_data.rollups == NULL)) {
     fprintf(stderr, "Error: Failed to create hashmap structures\n");
     clear_resources();
     exit(EXIT_FAILURE);
   }
+}
+
+
+// Adds the files named on the command line, in order, and returns how many
+// directories there were, listed in dirs. -1 if out of memory.
+static int add_inputs(int argc, char** argv, int first, char*** dirs) {
+  int dir_count = 0;
+  *dirs = malloc(sizeof(char*) * (argc - first));
+  if (*dirs == NULL) return -1;
 
-  return num_files;
+  for (int i = first; i < argc; i++) {
+    struct stat file_info;
+
+    if (stat(argv[i], &file_info) == 0 && S_ISDIR(file_info.st_mode)) {
+      (*dirs)[dir_count++] = argv[i];
+    } else if (input_list_add(inputs, argv[i], strlen(argv[i]), INPUT_NAMED) != 0) {
+      return -1;
+    }
+  }
+
+  return dir_count;
+}
+
+
+static void parse_input(Input* input) {
+  int result = -1;
+  double start = stats_start();
+
+  if (pomofile_init(&input->pomofile, input->path) == 0) {
+    result = pomofile_parse(&input->pomofile, &process_data);
+  } else {
+    fprintf(stderr, "Error: Failed to initialize PomoFile for '%s'\n", input->path);
+  }
+
+  stats_stop(PHASE_PARSE, start);
+  input_list_parsed(inputs, input, result);
 }
 
 
+// Worker 0 is the main thread, see input_list_wait()
+static void* parse_worker(void* arg) {
+  int worker = (int)(intptr_t)arg;
+  Input* input;
+
+  while ((input = input_list_claim(inputs, worker)) != NULL) {
+    parse_input(input);
+  }
+
+  return NULL;
+}
+
+
+// A file found in a directory may turn out to be included by another one,
+// even after it was merged. Then what it added is taken back, and the
+// duration of its date is worked out again by resolve_durations().
+static void note_includes(Input* input) {
+  PomoFile* pomofile = &input->pomofile;
+
+  for (int i = 1; i < pomofile->dependency_count; i++) {
+    const char* path = pomofile->dependencies[i].path;
+    if (hashmap_get(included, path) != NULL) continue;
+
+    hashmap_put(included, path, (void*)path);
+
+    Input* found = hashmap_get(merged_found, path);
+    if (found != NULL && !found->skipped) {
+      pomofile_unmerge(&found->pomofile, process_data.global_registers, &process_data);
+      found->skipped = true;
+    }
+  }
+}
+
+
+static void merge_input(Input* input) {
+  PomoFile* pomofile = &input->pomofile;
+  const char* own_path = pomofile->dependency_count > 0 ? pomofile->dependencies[0].path : NULL;
+
+  if (included != NULL) {
+    note_includes(input);
+
+    if (input->found && own_path && hashmap_get(included, own_path) != NULL) {
+      input->skipped = true;
+      return;
+    }
+  }
+
+  double start = stats_start();
+  pomofile_merge(pomofile, process_data.global_registers, &process_data);
+  stats_stop(PHASE_MERGE, start);
+
+  if (included != NULL && input->found && own_path) {
+    hashmap_put(merged_found, own_path, input);
+  }
+}
+
+
+static void set_last_duration(const char* date, void* value, void* user_data) {
+  Input* input = (Input*)value;
+  (void)date;
+  (void)user_data;
+
+  pomofile_set_duration(&process_data, input->pomofile.date, input->pomofile.pomodoro_duration);
+}
+
+
+// A date takes the duration of its last file still merged, in input_order().
+// Files found by several walkers, or read again for being out of range, are
+// merged in another order, so it's worked out once they all were.
+static void resolve_durations(void) {
+  int count = input_list_count(inputs);
+  HashMap* last_files = hashmap_create(INITIAL_HASHMAP_SIZE, LOAD_FACTOR);
+  if (last_files == NULL) {
+    fprintf(stderr, "Error: cannot work out the pomodoro durations\n");
+    return;
+  }
+
+  for (int i = 0; i < count; i++) {
+    Input* input = input_list_get(inputs, i);
+    if (input->result != 1 || input->skipped) continue;
+
+    char date[DATE_STRING_SIZE];
+    day_to_string(input->pomofile.date, date);
+    Input* last = hashmap_get(last_files, date);
+    if (last == NULL || input_order(last, input) < 0) {
+      hashmap_put(last_files, date, input);
+    }
+  }
+
+  hashmap_foreach(last_files, set_last_duration, NULL);
+  hashmap_destroy(last_files, NULL);
+}
+
+
+// With no date inside -a and -b every date is printed, so the files left
+// unread for being out of range are read and merged after all
+static void read_out_of_range(void) {
+  int count = input_list_count(inputs);
+  process_data.skip_out_of_range = false;
+
+  for (int i = 0; i < count; i++) {
+    Input* input = input_list_get(inputs, i);
+    if (input->result != POMOFILE_OUT_OF_RANGE) continue;
+
+    free_pomofile(&input->pomofile);
+    parse_input(input);
+    if (input->result == 1) {
+      merge_input(input);
+    }
+  }
+}
+
+
+static void free_registers(void* registers) {
+  register_map_destroy((RegisterMap*)registers);
+}
+
+
+// Filters the global registers and prints them, in date order
+static void print_report(void) {
+  int first, end;
+  double start = stats_start();
+  filter_registers(&process_data, &first, &end);
+  stats_stop(PHASE_FILTER, start);
+
+  start = stats_start();
+  if (options.summary_flag) {
+    print_summary(&process_data, first, end);
+  } else if (options.by_period != -1) {
+    print_periods(&process_data, options.by_period, first, end, options.reverse_flag);
+  } else {
+    process_data.exporter->begin();
+    print_dates(&process_data, first, end, options.reverse_flag);
+    process_data.exporter->end();
+  }
+
+  output_flush();
+  stats_stop(PHASE_RENDER, start);
+}
+
+
+
+static void publish_report(void) {
+  server_publish(server, &process_data);
+}
+
+
+// Answers queries until SIGINT or SIGTERM, reloading the files that change
+static void serve(void) {
+  sigset_t signals;
+  sigset_t previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+
+  // The server threads leave the signals to this one
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+  server = server_start(options.serve_path, &process_data);
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  if (server == NULL) {
+    clear_resources();
+    exit(EXIT_FAILURE);
+  }
+
+  if (watch_run(inputs, &process_data, publish_report) != 0) {
+    int signal_number;
+    fprintf(stderr, "Warning: changed files won't be reloaded\n");
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    sigwait(&signals, &signal_number);
+  }
+
+  server_stop(server);
+  server = NULL;
+}
+
 int main(int argc, char** argv) {
   if (argc < 2) {
     usage();
@@ -250,46 +636,117 @@ int main(int argc, char** argv) {
   int options_count = parse_options(argc, argv);
 
   // Initialize structures
-  int num_files = initialize_pomofiles(argc, options_count);
-
-  // Initialize each pomofile
-  int file_index = 1 + options_count; // Skip program name and options
-  for (int i = 0; i < num_files; i++, file_index++) {
-    int result = pomofile_init(&pomofiles_array[i], argv[file_index]);
-    if (result != 0) {
-      handle_initialization_error(i, argv[file_index]);
+  initialize_pomofiles(argc, options_count);
+
+  // Directories are walked while the files already known are parsed
+  char** dirs = NULL;
+  input_list_open(inputs);
+  int dir_count = add_inputs(argc, argv, 1 + options_count, &dirs);
+  Walker* walker = NULL;
+  Manifest* manifest = NULL;
+
+  if (options.manifest_path != NULL) {
+    manifest = manifest_start(inputs, options.manifest_path);
+    if (manifest == NULL) {
+      input_list_close(inputs);
+      free(dirs);
+      clear_resources();
+      exit(EXIT_FAILURE);
     }
   }
 
-  // Parse all files
-  for (int i = 0; i < num_files; i++) {
-    parse_file(&pomofiles_array[i], process_data.global_registers, &process_data);
+  if (dir_count > 0) {
+    process_data.track_dependencies = true;
+    included = hashmap_create(INITIAL_HASHMAP_SIZE, LOAD_FACTOR);
+    merged_found = hashmap_create(INITIAL_HASHMAP_SIZE, LOAD_FACTOR);
+    walker = walker_start(inputs, dirs, dir_count, options.jobs);
   }
+  input_list_close(inputs);
 
-  // Process global data
-  filter_registers(&process_data, filtered_registers);
-  HashMap** final_registers = NULL;
+  if (dir_count < 0 || (dir_count > 0 && (!walker || !included || !merged_found))) {
+    fprintf(stderr, "Error: cannot read the input files\n");
+    walker_join(walker);
+    manifest_join(manifest);
+    free(dirs);
+    clear_resources();
+    exit(EXIT_FAILURE);
+  }
 
-  if (hashmap_size(filtered_registers) == 0) {
-    final_registers = &process_data.global_registers;
-  } else {
-    final_registers = &filtered_registers;
+  // Workers parse files as they come, the merge takes them in the order
+  // they were added. Only the durations depend on it, and
+  // resolve_durations() fixes them when walkers made it vary. This thread
+  // parses too while the next file to merge isn't ready.
+  int worker_count = 0;
+  pthread_t* workers = malloc(sizeof(pthread_t) * options.jobs);
+  for (int i = 1; workers && i < options.jobs; i++, worker_count++) {
+    if (pthread_create(&workers[worker_count], NULL, parse_worker, (void*)(intptr_t)i) != 0) {
+      fprintf(stderr, "Warning: could only start %d worker threads\n", worker_count + 1);
+      break;
+    }
   }
 
-  // Export to HTML
-  if (options.export_flag && strcmp(options.export_type, "html") == 0) {
-    print_html_top_part();
-    hashmap_foreach(*final_registers, process_final_registers, &process_data);
-    print_html_down_part();
-  // Normal output
+  for (int i = 0; ; i++) {
+    Input* work;
+    Input* input;
+
+    while ((input = input_list_wait(inputs, i, &work)) == NULL && work != NULL) {
+      parse_input(work);
+    }
+    if (input == NULL) {
+      break;
+    }
+
+    if (input->result == 1) {
+      merge_input(input);
+    } else if (input->result == POMOFILE_OUT_OF_RANGE && included != NULL) {
+      note_includes(input); // What it includes still doesn't count on its own
+    }
+  }
+
+  for (int i = 0; i < worker_count; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+  walker_join(walker);
+  int manifest_result = manifest_join(manifest);
+  free(dirs);
+
+  // Part of the list is missing, a report of the rest would look complete
+  if (manifest_result < 0) {
+    clear_resources();
+    exit(EXIT_FAILURE);
+  }
+
+  bool read_again = process_data.skip_out_of_range && !has_dates_in_range(&process_data);
+  if (read_again) {
+    read_out_of_range();
+  }
+  if (read_again || included != NULL) {
+    resolve_durations();
+  }
+
+  int num_files = input_list_count(inputs);
+  if (num_files == 0) {
+    fprintf(stderr, "Error: No input files found\n");
+  }
+  STATS_ADD(files, num_files);
+
+  if (options.serve_path) {
+    serve();
   } else {
-    hashmap_foreach(*final_registers, process_final_registers, &process_data);
+    print_report();
   }
 
-  // Cleanup
-  for (int i = 0; i < num_files; i++) {
-    free_pomofile(&pomofiles_array[i]);
+  // Keep the registers up to date, printing them again on every change
+  if (options.watch_flag) {
+    watch_run(inputs, &process_data, print_report);
   }
+
+  // Files parsed in this run are reused by the next one
+  pfc_cache_save(process_data.pfc_cache);
+  stats_print();
+
+  // Cleanup
   clear_resources();
 
   return EXIT_SUCCESS;
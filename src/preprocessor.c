@@ -4,92 +4,698 @@
  * 
  * See LICENSE file for full BSD 3-Clause license terms.
  */
+#define _XOPEN_SOURCE 700 // For realpath
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hashmap.h"
 #include "preprocessor.h"
+#include "stats.h"
 #include "util.h"
 
-// Recursive function that preprocess a file
-// Only directive supported: #include
-FILE* preprocess_file(const char* path, int depth) {
-  if (depth >= MAX_INCLUDE_DEPTH) {
-    fprintf(stderr, "Error: max depth of includes reached\n");
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+typedef enum {
+  TABLE_UNKNOWN,
+  TABLE_BUILDING,
+  TABLE_READY
+} TableState;
+
+#define READ_CHUNK_SIZE (64 * 1024)
+
+// Files read by a reader, without repetitions. Owns the paths.
+typedef struct {
+  FileStamp* stamps;
+  int count;
+  int capacity;
+} StampList;
+
+// Contents of a file, mapped in memory when possible
+typedef struct {
+  char* data;
+  size_t length;
+  bool mapped;
+} FileData;
+
+typedef struct {
+  char* path;         // Resolved path
+  FileData contents;  // Raw, nested includes are expanded when read
+  FileStamp stamp;    // Version read, its path is the one above
+  TableState table_state;
+  void* table;        // Built once by parse_table, NULL if unusable
+  StampList nested;   // Includes read while building the table
+} CachedInclude;
+
+struct IncludeCache {
+  pthread_mutex_t lock;
+  HashMap* includes;              // key -> CachedInclude*
+  IncludeTableParser parse_table;
+  void (*free_table)(void*);
+};
+
+// Includes still current, moved to a new map so the old keys go too
+typedef struct {
+  IncludeCache* cache;
+  HashMap* kept;
+} Revalidation;
+
+// One level of the include stack
+typedef struct {
+  char* path;
+  char* dir;
+  FileData owned;     // Loaded for this source only, or empty
+  const char* text;   // Contents, owned or kept in the include cache
+  size_t length;
+  size_t offset;
+  int line_n;
+} Source;
+
+struct PomoReader {
+  Source sources[MAX_INCLUDE_DEPTH];
+  int top;            // Current source, -1 when everything was read
+  int base_depth;     // Include depth of sources[0]
+  bool quiet;         // Don't report errors, used while building tables
+  IncludeCache* cache;
+  IncludeTableHook hook;
+  void* user_data;
+  StampList dependencies; // Every file read, the opened one first
+};
+
+static void init_stamp(FileStamp* stamp, const char* path, const struct stat* file_info);
+static void add_stamp(StampList* list, const FileStamp* stamp);
+static void add_stamps(StampList* list, const StampList* other);
+static void free_stamps(StampList* list);
+static void add_file_stamp(StampList* list, const char* path);
+
+static int load_file(const char* path, FileData* file, bool allow_map);
+static void release_file(FileData* file);
+static void free_cached_include(const char* key, void* value, void* cache);
+static bool is_include_current(const CachedInclude* include);
+static void keep_current_include(const char* key, void* value, void* revalidation);
+static CachedInclude* lookup_include(IncludeCache* cache, const char* path, bool quiet);
+static void* get_include_table(IncludeCache* cache, CachedInclude* include);
+
+static PomoReader* reader_create(IncludeCache* cache, int base_depth, bool quiet);
+static int push_source(PomoReader* reader, const char* path, FileData* owned, CachedInclude* include);
+static void pop_source(PomoReader* reader);
+static const char* read_source_line(Source* source, size_t* length);
+static bool handle_include(PomoReader* reader, Source* source, const char* directive, size_t length);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// The path isn't copied. Without file_info, the file is a missing one.
+static void init_stamp(FileStamp* stamp, const char* path, const struct stat* file_info) {
+  stamp->path = (char*)path;
+  stamp->mtime = file_info ? (long long)file_info->st_mtim.tv_sec * 1000000000LL + file_info->st_mtim.tv_nsec : -1;
+  stamp->size = file_info ? (long long)file_info->st_size : -1;
+}
+
+static void add_stamp(StampList* list, const FileStamp* stamp) {
+  for (int i = 0; i < list->count; i++) {
+    if (strcmp(list->stamps[i].path, stamp->path) == 0) {
+      return;
+    }
+  }
+
+  if (list->count == list->capacity) {
+    int capacity = list->capacity > 0 ? list->capacity * 2 : 4;
+    FileStamp* stamps = realloc(list->stamps, sizeof(FileStamp) * capacity);
+    if (stamps == NULL) return;
+
+    list->stamps = stamps;
+    list->capacity = capacity;
+  }
+
+  char* path = malloc(strlen(stamp->path) + 1);
+  if (path == NULL) return;
+  strcpy(path, stamp->path);
+
+  list->stamps[list->count] = *stamp;
+  list->stamps[list->count].path = path;
+  list->count++;
+}
+
+static void add_stamps(StampList* list, const StampList* other) {
+  for (int i = 0; i < other->count; i++) {
+    add_stamp(list, &other->stamps[i]);
+  }
+}
+
+static void free_stamps(StampList* list) {
+  for (int i = 0; i < list->count; i++) {
+    free(list->stamps[i].path);
+  }
+  free(list->stamps);
+
+  list->stamps = NULL;
+  list->count = 0;
+  list->capacity = 0;
+}
+
+// Stamps a file as it is now, before it's read
+static void add_file_stamp(StampList* list, const char* path) {
+  struct stat file_info;
+  char resolved_path[PATH_MAX];
+  FileStamp stamp;
+
+  if (stat(path, &file_info) == -1) {
+    init_stamp(&stamp, path, NULL);
+  } else {
+    init_stamp(&stamp, realpath(path, resolved_path) ? resolved_path : path, &file_info);
+  }
+
+  add_stamp(list, &stamp);
+}
+
+static void free_cached_include(const char* key, void* value, void* cache) {
+  CachedInclude* include = (CachedInclude*)value;
+  void (*free_table)(void*) = ((IncludeCache*)cache)->free_table;
+  (void)key;
+
+  if (include->table && free_table) {
+    free_table(include->table);
+  }
+  free(include->path);
+  release_file(&include->contents);
+  free_stamps(&include->nested);
+  free(include);
+}
+
+// The include and the ones its table was built from are as they were read
+static bool is_include_current(const CachedInclude* include) {
+  if (!file_stamp_is_current(&include->stamp)) {
+    return false;
+  }
+
+  for (int i = 0; i < include->nested.count; i++) {
+    if (!file_stamp_is_current(&include->nested.stamps[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void keep_current_include(const char* key, void* value, void* revalidation) {
+  Revalidation* state = (Revalidation*)revalidation;
+
+  if (is_include_current((CachedInclude*)value)) {
+    hashmap_put(state->kept, key, value);
+  } else {
+    free_cached_include(key, value, state->cache);
+  }
+}
+
+// Maps a regular file in memory. Pipes and other special files, or files
+// that can't be mapped, are read into a buffer in large chunks.
+static int load_file(const char* path, FileData* file, bool allow_map) {
+  file->data = NULL;
+  file->length = 0;
+  file->mapped = false;
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+
+  struct stat file_info;
+  if (fstat(fd, &file_info) == -1) {
+    close(fd);
+    return -1;
+  }
+
+  if (S_ISREG(file_info.st_mode) && file_info.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+
+  if (allow_map && S_ISREG(file_info.st_mode)) {
+    void* data = mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data != MAP_FAILED) {
+      posix_madvise(data, file_info.st_size, POSIX_MADV_SEQUENTIAL);
+      file->data = data;
+      file->length = file_info.st_size;
+      file->mapped = true;
+      close(fd);
+      return 0;
+    }
+  }
+
+  size_t capacity = S_ISREG(file_info.st_mode) ? (size_t)file_info.st_size + 1 : READ_CHUNK_SIZE;
+  char* data = malloc(capacity);
+
+  for (;;) {
+    if (data == NULL) {
+      close(fd);
+      return -1;
+    }
+
+    if (file->length == capacity) {
+      capacity *= 2;
+      char* bigger = realloc(data, capacity);
+      if (bigger == NULL) {
+        free(data);
+      }
+      data = bigger;
+      continue;
+    }
+
+    ssize_t n = read(fd, data + file->length, capacity - file->length);
+    if (n == 0) {
+      break;
+    }
+    if (n < 0) {
+      free(data);
+      close(fd);
+      file->length = 0;
+      return -1;
+    }
+    file->length += n;
+  }
+
+  close(fd);
+  file->data = data;
+  return 0;
+}
+
+static void release_file(FileData* file) {
+  if (file->mapped) {
+    munmap(file->data, file->length);
+  } else {
+    free(file->data);
+  }
+
+  file->data = NULL;
+  file->length = 0;
+  file->mapped = false;
+}
+
+// Returns the include from the cache, reading it only the first time this
+// version of the file is seen
+static CachedInclude* lookup_include(IncludeCache* cache, const char* path, bool quiet) {
+  struct stat file_info;
+  char resolved_path[PATH_MAX];
+
+  if (stat(path, &file_info) == -1 || realpath(path, resolved_path) == NULL) {
+    if (!quiet) fprintf(stderr, "Error: cannot read file '%s'\n", path);
     return NULL;
   }
 
-  FILE* file = fopen(path, "r");
-  if (file == NULL) {
-    fprintf(stderr, "Error: cannot read file '%s'\n", path);
+  FileStamp stamp;
+  init_stamp(&stamp, resolved_path, &file_info);
+
+  char key[PATH_MAX + 128];
+  snprintf(key, sizeof(key), "%s|%lu|%lu|%lld|%lld", resolved_path,
+           (unsigned long)file_info.st_dev, (unsigned long)file_info.st_ino,
+           stamp.mtime, stamp.size);
+
+  pthread_mutex_lock(&cache->lock);
+  CachedInclude* include = hashmap_get(cache->includes, key);
+  pthread_mutex_unlock(&cache->lock);
+
+  if (include) {
+    return include;
+  }
+
+  // Copied rather than mapped, the cache may outlive changes to the file
+  FileData contents;
+  if (load_file(path, &contents, false) != 0) {
+    if (!quiet) fprintf(stderr, "Error: cannot read file '%s'\n", path);
+    return NULL;
+  }
+
+  include = malloc(sizeof(CachedInclude));
+  char* include_path = malloc(strlen(resolved_path) + 1);
+  if (include == NULL || include_path == NULL) {
+    free(include);
+    free(include_path);
+    release_file(&contents);
     return NULL;
   }
+  strcpy(include_path, resolved_path);
+  include->path = include_path;
+  include->contents = contents;
+  init_stamp(&include->stamp, include_path, &file_info);
+  include->table_state = TABLE_UNKNOWN;
+  include->table = NULL;
+  include->nested = (StampList){NULL, 0, 0};
+
+  pthread_mutex_lock(&cache->lock);
+  CachedInclude* existing = hashmap_get(cache->includes, key);
+  if (existing) {
+    // Another thread got there first
+    free_cached_include(key, include, cache);
+    include = existing;
+  } else {
+    hashmap_put(cache->includes, key, include);
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  return include;
+}
+
+// Parses the include into a table the first time it's asked for. While
+// another thread (or an include cycle) is building it, there is no table.
+static void* get_include_table(IncludeCache* cache, CachedInclude* include) {
+  if (cache->parse_table == NULL) return NULL;
+
+  pthread_mutex_lock(&cache->lock);
+  TableState state = include->table_state;
+  void* table = include->table;
+  if (state == TABLE_UNKNOWN) {
+    include->table_state = TABLE_BUILDING;
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  if (state != TABLE_UNKNOWN) {
+    return state == TABLE_READY ? table : NULL;
+  }
+
+  PomoReader* reader = reader_create(cache, 1, true);
+  if (reader != NULL && push_source(reader, include->path, NULL, include) == 0) {
+    table = cache->parse_table(reader);
+  }
+
+  pthread_mutex_lock(&cache->lock);
+  include->table = table;
+  include->table_state = TABLE_READY;
+  if (reader != NULL) {
+    // Whoever takes the table depends on these too
+    include->nested = reader->dependencies;
+    reader->dependencies = (StampList){NULL, 0, 0};
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  reader_close(reader);
+
+  return table;
+}
+
+static PomoReader* reader_create(IncludeCache* cache, int base_depth, bool quiet) {
+  PomoReader* reader = malloc(sizeof(PomoReader));
+  if (reader == NULL) return NULL;
+
+  reader->top = -1;
+  reader->base_depth = base_depth;
+  reader->quiet = quiet;
+  reader->cache = cache;
+  reader->hook = NULL;
+  reader->user_data = NULL;
+  reader->dependencies = (StampList){NULL, 0, 0};
+  return reader;
+}
+
+// Pushes a loaded file or a cached include on top of the stack. The
+// source takes over the loaded file, even on failure.
+static int push_source(PomoReader* reader, const char* path, FileData* owned, CachedInclude* include) {
+  if (reader->base_depth + reader->top + 1 >= MAX_INCLUDE_DEPTH) {
+    if (!reader->quiet) fprintf(stderr, "Error: max depth of includes reached\n");
+    if (owned) release_file(owned);
+    return -1;
+  }
+
+  Source* source = &reader->sources[reader->top + 1];
+  size_t path_len = strlen(path);
+  source->path = malloc(path_len + 1);
+  source->dir = malloc(path_len + 2);
+  if (source->path == NULL || source->dir == NULL) {
+    free(source->path);
+    free(source->dir);
+    if (owned) release_file(owned);
+    return -1;
+  }
+
+  memcpy(source->path, path, path_len + 1);
+  extract_directory(path, source->dir, path_len + 2);
+
+  if (owned) {
+    source->owned = *owned;
+  } else {
+    source->owned.data = NULL;
+    source->owned.length = 0;
+    source->owned.mapped = false;
+  }
+
+  const FileData* contents = include ? &include->contents : &source->owned;
+  source->text = contents->data;
+  source->length = contents->length;
+  source->offset = 0;
+  source->line_n = 0;
+
+  reader->top++;
+  return 0;
+}
 
-  FILE* output = tmpfile();
-  if (output == NULL) {
-    fclose(file);
+static void pop_source(PomoReader* reader) {
+  Source* source = &reader->sources[reader->top];
+
+  STATS_ADD(lines, source->line_n);
+  release_file(&source->owned);
+  free(source->path);
+  free(source->dir);
+
+  reader->top--;
+}
+
+// Returns a view of the next line of a source, without its newline
+static const char* read_source_line(Source* source, size_t* length) {
+  if (source->offset >= source->length) {
     return NULL;
   }
 
-  char current_dir[1024];
-  extract_directory(path, current_dir, sizeof(current_dir));
+  const char* start = source->text + source->offset;
+  size_t remaining = source->length - source->offset;
+  const char* newline = memchr(start, '\n', remaining);
+  size_t len = newline ? (size_t)(newline - start) : remaining;
+
+  source->offset += newline ? len + 1 : len;
+  *length = len;
+  return start;
+}
+
+// Only directive supported: #include
+// Returns false when the directive line must be handed over as it is
+static bool handle_include(PomoReader* reader, Source* source, const char* directive, size_t length) {
+  const char* end = directive + length;
+  const char* quote_start = memchr(directive, '"', length);
+  if (!quote_start) return false;
+
+  // quote_start + 1 because quote_start is '"'
+  const char* quote_end = memchr(quote_start + 1, '"', end - (quote_start + 1));
+  if (!quote_end) return false;
 
-  char line[2048];
+  char include_filename[256];
   char full_include_path[2048];
+  size_t len = quote_end - (quote_start + 1);
+  if (len >= sizeof(include_filename)) {
+    len = sizeof(include_filename) - 1;
+  }
+
+  // Copies exactly the name of the include file
+  strncpy(include_filename, quote_start + 1, len);
+  include_filename[len] = '\0';
 
-  while (fgets(line, sizeof(line), file) != NULL) {
-    char* trimmed = trim_left(line);
-    
-    if (strncmp(trimmed, "#include", 8) == 0) {
-      char* quote_start = strchr(trimmed, '"');
-
-      if (quote_start) {
-        // quote_start + 1 because quote_start is '"'
-        char* quote_end = strchr(quote_start + 1, '"');
-
-        if (quote_end) {
-          size_t len = quote_end - (quote_start + 1);
-          char include_filename[256];
-          // Copies exactly the name of the include file
-          strncpy(include_filename, quote_start + 1, len);
-          include_filename[len] = '\0';
-
-          // Determines full include path
-          if (include_filename[0] == '/'
+  // Determines full include path
+  if (include_filename[0] == '/'
 #ifdef _WIN32
-              || include_filename[0] == '\\'
-              || (isalpha(include_filename[0]) && include_filename[1] == ':')
+      || include_filename[0] == '\\'
+      || (isalpha(include_filename[0]) && include_filename[1] == ':')
 #endif
-          ) {
-            strncpy(full_include_path, include_filename, sizeof(full_include_path) - 1);
-          } else {
-            // Relative path
-            snprintf(full_include_path, sizeof(full_include_path), "%s/%s", current_dir, include_filename);
-          }
-
-          FILE* processed_include = preprocess_file(full_include_path, depth + 1);
-
-          if (processed_include != NULL) {
-            // Copies processed content
-            char buffer[1024];
-            rewind(processed_include);
-
-            while (fgets(buffer, sizeof(buffer), processed_include) != NULL) {
-              fputs(buffer, output);
-            }
-
-            fclose(processed_include);
-          } else {
-            fprintf(stderr, "Warning: could not preprocess file '%s' included from '%s'\n", include_filename, path);
-            fputs(line, output);
-          }
-          continue;
+  ) {
+    snprintf(full_include_path, sizeof(full_include_path), "%s", include_filename);
+  } else {
+    // Relative path
+    snprintf(full_include_path, sizeof(full_include_path), "%s/%s", source->dir, include_filename);
+  }
+
+  int result = -1;
+  if (reader->cache != NULL) {
+    CachedInclude* include = lookup_include(reader->cache, full_include_path, reader->quiet);
+
+    if (include != NULL) {
+      add_stamp(&reader->dependencies, &include->stamp);
+
+      if (reader->hook != NULL) {
+        void* table = get_include_table(reader->cache, include);
+        if (table != NULL && reader->hook(table, reader->user_data)) {
+          add_stamps(&reader->dependencies, &include->nested);
+          STATS_ADD(includes, 1);
+          return true;
         }
       }
+      result = push_source(reader, full_include_path, NULL, include);
+    } else {
+      add_file_stamp(&reader->dependencies, full_include_path);
+    }
+  } else {
+    FileData contents;
+    add_file_stamp(&reader->dependencies, full_include_path);
+    if (load_file(full_include_path, &contents, true) != 0) {
+      if (!reader->quiet) fprintf(stderr, "Error: cannot read file '%s'\n", full_include_path);
+    } else {
+      result = push_source(reader, full_include_path, &contents, NULL);
+    }
+  }
+
+  if (result != 0) {
+    if (!reader->quiet) {
+      fprintf(stderr, "Warning: could not preprocess file '%s' included from '%s'\n", include_filename, source->path);
     }
+    return false;
+  }
+
+  STATS_ADD(includes, 1);
+  return true;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+IncludeCache* include_cache_create(IncludeTableParser parse_table, void (*free_table)(void*)) {
+  IncludeCache* cache = malloc(sizeof(IncludeCache));
+  if (cache == NULL) return NULL;
+
+  cache->includes = hashmap_create(16, 0.75);
+  if (cache->includes == NULL) {
+    free(cache);
+    return NULL;
+  }
+
+  pthread_mutex_init(&cache->lock, NULL);
+  cache->parse_table = parse_table;
+  cache->free_table = free_table;
+  return cache;
+}
+
+// Drops the includes that changed since they were read, or whose table was
+// built from includes that did, so the next readers read them again. No
+// reader may be open. Returns -1 if out of memory.
+int include_cache_revalidate(IncludeCache* cache) {
+  Revalidation revalidation = {cache, hashmap_create(hashmap_size(cache->includes) + 16, 0.75)};
+  if (revalidation.kept == NULL) return -1;
+
+  hashmap_foreach(cache->includes, keep_current_include, &revalidation);
+  hashmap_destroy(cache->includes, NULL);
+  cache->includes = revalidation.kept;
+  return 0;
+}
+
+void include_cache_destroy(IncludeCache* cache) {
+  if (cache == NULL) return;
+
+  hashmap_foreach(cache->includes, free_cached_include, cache);
+  hashmap_destroy(cache->includes, NULL);
+  pthread_mutex_destroy(&cache->lock);
+  free(cache);
+}
+
+// Opens a file for preprocessed reading. With a cache, every include is
+// read once per run and may be handed to hook already parsed. Without
+// allow_map the file is copied, a mapped one that is truncated while read
+// kills the process with SIGBUS.
+PomoReader* reader_open(const char* path, IncludeCache* cache, bool allow_map,
+                        IncludeTableHook hook, void* user_data) {
+  PomoReader* reader = reader_create(cache, 0, false);
+  if (reader == NULL) {
+    return NULL;
+  }
+  reader->hook = hook;
+  reader->user_data = user_data;
+  add_file_stamp(&reader->dependencies, path);
+
+  FileData contents;
+  if (load_file(path, &contents, allow_map) != 0) {
+    fprintf(stderr, "Error: cannot read file '%s'\n", path);
+    reader_close(reader);
+    return NULL;
+  }
+
+  if (push_source(reader, path, &contents, NULL) != 0) {
+    reader_close(reader);
+    return NULL;
+  }
+
+  return reader;
+}
+
+// Returns a view of the next line, without its newline, or NULL at the end.
+// The line points into the file's contents and isn't NUL terminated.
+const char* reader_next_line(PomoReader* reader, size_t* length) {
+  while (reader->top >= 0) {
+    Source* source = &reader->sources[reader->top];
+    size_t len;
+    const char* line = read_source_line(source, &len);
+
+    if (line == NULL) {
+      pop_source(reader);
+      continue;
+    }
+    source->line_n++;
+
+    size_t trimmed_len = len;
+    const char* trimmed = trim_view(line, &trimmed_len);
+    if (trimmed_len >= 8 && memcmp(trimmed, "#include", 8) == 0 &&
+        handle_include(reader, source, trimmed, trimmed_len)) {
+      continue;
+    }
+
+    *length = len;
+    return line;
+  }
+
+  return NULL;
+}
+
+// File of the last line read
+const char* reader_path(PomoReader* reader) {
+  return reader->top >= 0 ? reader->sources[reader->top].path : NULL;
+}
+
+// Line number of the last line read, inside reader_path()
+int reader_line_number(PomoReader* reader) {
+  return reader->top >= 0 ? reader->sources[reader->top].line_n : 0;
+}
+
+// Include level of the last line read, 0 for the file opened
+int reader_depth(PomoReader* reader) {
+  return reader->top;
+}
+
+void reader_close(PomoReader* reader) {
+  if (reader == NULL) return;
+
+  while (reader->top >= 0) {
+    pop_source(reader);
+  }
+  free_stamps(&reader->dependencies);
+  free(reader);
+}
+
+// Files read so far, the one opened first. Includes that couldn't be found
+// are there too, as missing files.
+int reader_dependency_count(PomoReader* reader) {
+  return reader ? reader->dependencies.count : 0;
+}
+
+const FileStamp* reader_dependencies(PomoReader* reader) {
+  return reader ? reader->dependencies.stamps : NULL;
+}
+
+// Whether the file is still the version stamped
+bool file_stamp_is_current(const FileStamp* stamp) {
+  struct stat file_info;
+  FileStamp current;
 
-    fputs(line, output);
+  if (stat(stamp->path, &file_info) == -1) {
+    return stamp->size == -1;
   }
 
-  fclose(file);
-  rewind(output);
-  return output;
+  init_stamp(&current, stamp->path, &file_info);
+  return current.mtime == stamp->mtime && current.size == stamp->size;
 }
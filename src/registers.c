@@ -0,0 +1,272 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "registers.h"
+#include "subjects.h"
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static unsigned int hash(int subject);
+static int round_capacity(int capacity);
+static Register* find_slot(RegisterMap* map, int subject);
+static int add_lines(RegisterMap* map, int subject, int pomodoros, int lines);
+static void remove_slot(RegisterMap* map, Register* reg);
+static int resize(RegisterMap* map, int capacity);
+static int compare_subject_names(const void* a, const void* b);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Ids are dense, mixing them is enough
+static unsigned int hash(int subject) {
+  unsigned int hash = (unsigned int)subject * 2654435761u;
+  return hash ^ (hash >> 16);
+}
+
+static int round_capacity(int capacity) {
+  int rounded = 16;
+
+  while (rounded < capacity) {
+    rounded *= 2;
+  }
+
+  return rounded;
+}
+
+// Slot holding the subject, or the empty one where it would go
+static Register* find_slot(RegisterMap* map, int subject) {
+  int mask = map->capacity - 1;
+  int index = (int)(hash(subject) & mask);
+
+  while (map->slots[index].subject != -1 && map->slots[index].subject != subject) {
+    index = (index + 1) & mask;
+  }
+
+  return &map->slots[index];
+}
+
+// A sum past INT_MAX stays at INT_MAX and returns -1
+static int add_lines(RegisterMap* map, int subject, int pomodoros, int lines) {
+  Register* reg = find_slot(map, subject);
+
+  if (reg->subject == subject) {
+    int sum;
+    if (__builtin_add_overflow(reg->pomodoros, pomodoros, &sum)) {
+      reg->pomodoros = pomodoros > 0 ? INT_MAX : INT_MIN;
+      reg->lines += lines;
+      return -1;
+    }
+
+    reg->pomodoros = sum;
+    reg->lines += lines;
+    return 0;
+  }
+
+  if ((float)(map->size + 1) / map->capacity > map->load_factor) {
+    if (resize(map, map->capacity * 2) == 0) {
+      reg = find_slot(map, subject);
+    } else if (map->size + 1 == map->capacity) {
+      return 0; // Full, keep one slot empty so probes end
+    }
+  }
+
+  reg->subject = subject;
+  reg->pomodoros = pomodoros;
+  reg->lines = lines;
+  map->size++;
+  return 0;
+}
+
+// Empties a slot, moving back the entries after it that can't be found
+// past the gap anymore
+static void remove_slot(RegisterMap* map, Register* reg) {
+  int mask = map->capacity - 1;
+  int gap = (int)(reg - map->slots);
+
+  map->slots[gap].subject = -1;
+  map->size--;
+
+  for (int index = (gap + 1) & mask; map->slots[index].subject != -1; index = (index + 1) & mask) {
+    int home = (int)(hash(map->slots[index].subject) & mask);
+
+    // Stays if its home is cyclically in (gap, index]
+    bool reachable = gap <= index ? (gap < home && home <= index) : (gap < home || home <= index);
+    if (!reachable) {
+      map->slots[gap] = map->slots[index];
+      map->slots[index].subject = -1;
+      gap = index;
+    }
+  }
+}
+
+static int resize(RegisterMap* map, int capacity) {
+  Register* old_slots = map->slots;
+  int old_capacity = map->capacity;
+
+  Register* slots = malloc(sizeof(Register) * capacity);
+  if (!slots) return -1;
+  memset(slots, -1, sizeof(Register) * capacity);
+
+  map->slots = slots;
+  map->capacity = capacity;
+
+  for (int i = 0; i < old_capacity; i++) {
+    if (old_slots[i].subject != -1) {
+      *find_slot(map, old_slots[i].subject) = old_slots[i];
+    }
+  }
+
+  free(old_slots);
+  return 0;
+}
+
+static int compare_subject_names(const void* a, const void* b) {
+  return strcmp(subject_name(((const Register*)a)->subject), subject_name(((const Register*)b)->subject));
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+RegisterMap* register_map_create(int initial_capacity, float load_factor) {
+  RegisterMap* map = malloc(sizeof(RegisterMap));
+  if (!map) return NULL;
+
+  map->capacity = round_capacity(initial_capacity);
+  map->size = 0;
+  map->load_factor = (load_factor > 0.1 && load_factor < 1.0) ? load_factor : 0.75;
+
+  map->slots = malloc(sizeof(Register) * map->capacity);
+  if (!map->slots) {
+    free(map);
+    return NULL;
+  }
+  memset(map->slots, -1, sizeof(Register) * map->capacity);
+
+  return map;
+}
+
+// Adds the pomodoros of a register line to a subject, creating it if needed.
+// Returns -1 if the subject's total overflowed.
+int register_map_add(RegisterMap* map, int subject, int pomodoros) {
+  if (!map || subject < 0) return 0;
+
+  return add_lines(map, subject, pomodoros, 1);
+}
+
+// Pomodoros of a subject, 0 if it isn't there
+int register_map_get(RegisterMap* map, int subject) {
+  if (!map || subject < 0) return 0;
+
+  Register* reg = find_slot(map, subject);
+
+  return reg->subject == subject ? reg->pomodoros : 0;
+}
+
+// Adds every counter of src to dest. Returns how many subjects were new.
+int register_map_merge(RegisterMap* dest, RegisterMap* src) {
+  if (!dest || !src) return 0;
+  int added_elements = 0;
+
+  for (int i = 0; i < src->capacity; i++) {
+    Register* reg = &src->slots[i];
+    if (reg->subject == -1) continue;
+
+    int old_size = dest->size;
+    add_lines(dest, reg->subject, reg->pomodoros, reg->lines);
+    added_elements += dest->size - old_size;
+  }
+
+  return added_elements;
+}
+
+// Takes back what merging src into dest added. Returns how many subjects
+// were left without lines and removed.
+int register_map_subtract(RegisterMap* dest, RegisterMap* src) {
+  if (!dest || !src) return 0;
+  int removed_elements = 0;
+
+  for (int i = 0; i < src->capacity; i++) {
+    if (src->slots[i].subject == -1) continue;
+
+    Register* reg = find_slot(dest, src->slots[i].subject);
+    if (reg->subject == -1) continue;
+
+    reg->pomodoros -= src->slots[i].pomodoros;
+    reg->lines -= src->slots[i].lines;
+
+    if (reg->lines <= 0) {
+      remove_slot(dest, reg);
+      removed_elements++;
+    }
+  }
+
+  return removed_elements;
+}
+
+// Removes the subjects keep() returns false for. Returns how many were removed.
+int register_map_retain(RegisterMap* map, bool (*keep)(int, void*), void* user_data) {
+  if (!map || !keep || map->size == 0) return 0;
+
+  Register* kept = malloc(sizeof(Register) * map->size);
+  if (!kept) return 0;
+
+  int n = 0;
+  for (int i = 0; i < map->capacity; i++) {
+    if (map->slots[i].subject != -1 && keep(map->slots[i].subject, user_data)) {
+      kept[n++] = map->slots[i];
+    }
+  }
+
+  int removed_elements = map->size - n;
+
+  // Put the kept ones back, so no probe runs through a removed one
+  if (removed_elements > 0) {
+    memset(map->slots, -1, sizeof(Register) * map->capacity);
+    for (int i = 0; i < n; i++) {
+      *find_slot(map, kept[i].subject) = kept[i];
+    }
+    map->size = n;
+  }
+
+  free(kept);
+  return removed_elements;
+}
+
+int register_map_size(RegisterMap* map) {
+  return map ? map->size : 0;
+}
+
+// Calls back with the subjects in alphabetical order, so output doesn't
+// depend on the order ids were handed out
+void register_map_foreach(RegisterMap* map, void (*callback)(const char*, int, void*), void* user_data) {
+  if (!map || !callback || map->size == 0) return;
+
+  Register* sorted = malloc(sizeof(Register) * map->size);
+  if (!sorted) return;
+
+  int n = 0;
+  for (int i = 0; i < map->capacity; i++) {
+    if (map->slots[i].subject != -1) {
+      sorted[n++] = map->slots[i];
+    }
+  }
+
+  qsort(sorted, n, sizeof(Register), compare_subject_names);
+
+  for (int i = 0; i < n; i++) {
+    callback(subject_name(sorted[i].subject), sorted[i].pomodoros, user_data);
+  }
+
+  free(sorted);
+}
+
+void register_map_destroy(RegisterMap* map) {
+  if (!map) return;
+
+  free(map->slots);
+  free(map);
+}
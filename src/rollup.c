@@ -0,0 +1,268 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rollup.h"
+#include "util.h"
+
+#define ROLLUP_TABLE_SIZE 16
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static const char* period_names[PERIOD_COUNT] = {"week", "month", "year"};
+
+static int floor_div(int a, int b);
+static unsigned int hash(int subject);
+static RollupTotal* find_slot(RollupTable* table, int subject);
+static int resize(RollupTable* table, int capacity);
+static RollupTable* table_for(Rollups* rollups, Period period, int number);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+static int floor_div(int a, int b) {
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// Same mixing as the register maps, ids are dense
+static unsigned int hash(int subject) {
+  unsigned int hash = (unsigned int)subject * 2654435761u;
+  return hash ^ (hash >> 16);
+}
+
+// Slot holding the subject, or the empty one where it would go
+static RollupTotal* find_slot(RollupTable* table, int subject) {
+  int mask = table->capacity - 1;
+  int index = (int)(hash(subject) & mask);
+
+  while (table->slots[index].subject != -1 && table->slots[index].subject != subject) {
+    index = (index + 1) & mask;
+  }
+
+  return &table->slots[index];
+}
+
+static int resize(RollupTable* table, int capacity) {
+  RollupTotal* old_slots = table->slots;
+  int old_capacity = table->capacity;
+
+  RollupTotal* slots = malloc(sizeof(RollupTotal) * capacity);
+  if (!slots) return -1;
+  memset(slots, -1, sizeof(RollupTotal) * capacity);
+
+  table->slots = slots;
+  table->capacity = capacity;
+
+  for (int i = 0; i < old_capacity; i++) {
+    if (old_slots[i].subject != -1) {
+      *find_slot(table, old_slots[i].subject) = old_slots[i];
+    }
+  }
+
+  free(old_slots);
+  return 0;
+}
+
+// Table of a period, growing the array to reach it. It grows by as much
+// as it holds, so adding dates one after the other copies it few times.
+static RollupTable* table_for(Rollups* rollups, Period period, int number) {
+  int first = rollups->first[period];
+  int count = rollups->count[period];
+
+  if (count > 0 && number >= first && number - first < count) {
+    return &rollups->tables[period][number - first];
+  }
+
+  int slack = count > 8 ? count : 8;
+  int new_first = number;
+  int new_end = number + 1;
+  if (count > 0 && number < first) {
+    new_first = number < first - slack ? number : first - slack;
+    new_end = first + count;
+  } else if (count > 0) {
+    new_first = first;
+    new_end = number + 1 > first + count + slack ? number + 1 : first + count + slack;
+  }
+
+  RollupTable* tables = calloc(new_end - new_first, sizeof(RollupTable));
+  if (!tables) return NULL;
+
+  if (count > 0) {
+    memcpy(tables + (first - new_first), rollups->tables[period], sizeof(RollupTable) * count);
+  }
+  free(rollups->tables[period]);
+
+  rollups->tables[period] = tables;
+  rollups->first[period] = new_first;
+  rollups->count[period] = new_end - new_first;
+  return &tables[number - new_first];
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// Period called name, -1 if there's none
+int period_find(const char* name) {
+  for (int period = 0; period < PERIOD_COUNT; period++) {
+    if (strcmp(period_names[period], name) == 0) {
+      return period;
+    }
+  }
+
+  return -1;
+}
+
+// Number of the period holding a day, consecutive periods have
+// consecutive numbers
+int period_number(Period period, int day) {
+  int year, month, mday;
+
+  switch (period) {
+    case PERIOD_WEEK:
+      return floor_div(day + 3, 7); // 01/01/1970 was a Thursday
+    case PERIOD_MONTH:
+      civil_from_days(day, &year, &month, &mday);
+      return year * 12 + month - 1;
+    default:
+      civil_from_days(day, &year, &month, &mday);
+      return year;
+  }
+}
+
+// First day of a period, the one after its last is the first of number + 1
+int period_first_day(Period period, int number) {
+  switch (period) {
+    case PERIOD_WEEK:
+      return number * 7 - 3;
+    case PERIOD_MONTH:
+      return days_from_civil(floor_div(number, 12), number - floor_div(number, 12) * 12 + 1, 1);
+    default:
+      return days_from_civil(number, 1, 1);
+  }
+}
+
+// "dd/mm/yyyy" of its Monday for a week, "mm/yyyy" for a month and "yyyy"
+// for a year. buffer has PERIOD_STRING_SIZE chars.
+char* period_to_string(Period period, int number, char* buffer) {
+  switch (period) {
+    case PERIOD_WEEK:
+      return day_to_string(period_first_day(period, number), buffer);
+    case PERIOD_MONTH:
+      snprintf(buffer, PERIOD_STRING_SIZE, "%02d/%d",
+               number - floor_div(number, 12) * 12 + 1, floor_div(number, 12));
+      return buffer;
+    default:
+      snprintf(buffer, PERIOD_STRING_SIZE, "%d", number);
+      return buffer;
+  }
+}
+
+// Adds to the totals of a subject, creating it if needed. Returns -1 if
+// out of memory.
+int rollup_table_add(RollupTable* table, int subject, int lines, long long pomodoros, long long minutes) {
+  if (table->slots == NULL && resize(table, ROLLUP_TABLE_SIZE) != 0) {
+    return -1;
+  }
+
+  RollupTotal* total = find_slot(table, subject);
+  if (total->subject == subject) {
+    total->lines += lines;
+    total->pomodoros += pomodoros;
+    total->minutes += minutes;
+    return 0;
+  }
+
+  if ((table->size + 1) * 4 > table->capacity * 3) {
+    if (resize(table, table->capacity * 2) != 0) return -1;
+    total = find_slot(table, subject);
+  }
+
+  total->subject = subject;
+  total->lines = lines;
+  total->pomodoros = pomodoros;
+  total->minutes = minutes;
+  table->size++;
+  return 0;
+}
+
+// Adds every total of src to dest. Returns -1 if out of memory.
+int rollup_table_merge(RollupTable* dest, const RollupTable* src) {
+  for (int i = 0; i < src->capacity; i++) {
+    const RollupTotal* total = &src->slots[i];
+    if (total->subject == -1) continue;
+
+    if (rollup_table_add(dest, total->subject, total->lines, total->pomodoros, total->minutes) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// Removes every subject, keeping the memory
+void rollup_table_clear(RollupTable* table) {
+  if (table->slots != NULL) {
+    memset(table->slots, -1, sizeof(RollupTotal) * table->capacity);
+  }
+  table->size = 0;
+}
+
+void rollup_table_free(RollupTable* table) {
+  free(table->slots);
+  table->slots = NULL;
+  table->capacity = 0;
+  table->size = 0;
+}
+
+Rollups* rollups_create(void) {
+  return calloc(1, sizeof(Rollups));
+}
+
+// Adds sign times the lines and pomodoros of the registers of a day to its
+// week, month and year, each pomodoro counting minutes_per_pomodoro
+// minutes. Negative values take back what was added, sign 0 only changes
+// the minutes, for when the day's pomodoro duration changes.
+// Returns -1 if out of memory.
+int rollups_add(Rollups* rollups, int day, RegisterMap* registers, int sign, int minutes_per_pomodoro) {
+  for (int period = 0; period < PERIOD_COUNT; period++) {
+    RollupTable* table = table_for(rollups, period, period_number(period, day));
+    if (!table) return -1;
+
+    for (int i = 0; i < registers->capacity; i++) {
+      Register* reg = &registers->slots[i];
+      if (reg->subject == -1) continue;
+
+      if (rollup_table_add(table, reg->subject, sign * reg->lines, (long long)sign * reg->pomodoros,
+                           (long long)reg->pomodoros * minutes_per_pomodoro) != 0) {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+// Totals of a period, NULL if nothing was added to it
+const RollupTable* rollups_get(Rollups* rollups, Period period, int number) {
+  int offset = number - rollups->first[period];
+
+  if (offset < 0 || offset >= rollups->count[period]) return NULL;
+
+  RollupTable* table = &rollups->tables[period][offset];
+  return table->slots != NULL ? table : NULL;
+}
+
+void rollups_destroy(Rollups* rollups) {
+  if (!rollups) return;
+
+  for (int period = 0; period < PERIOD_COUNT; period++) {
+    for (int i = 0; i < rollups->count[period]; i++) {
+      rollup_table_free(&rollups->tables[period][i]);
+    }
+    free(rollups->tables[period]);
+  }
+  free(rollups);
+}
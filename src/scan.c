@@ -0,0 +1,257 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "scan.h"
+
+// SSE2 is always there on x86-64, AVX2 is checked for at run time. Without
+// optimization every 32 byte vector goes through the stack and AVX2 ends up
+// slower than SSE2, so GCC optimizes the AVX2 functions whatever the build.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SCAN_X86
+#define SCAN_AVX2
+#include <immintrin.h>
+#ifdef __clang__
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2"), optimize("O2")))
+#endif
+#endif
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static bool is_blank(unsigned char c);
+static int count_bits(unsigned int bits);
+static void add_marks(LineScan* scan, size_t offset, unsigned int equals, unsigned int colons);
+static void scan_range(const char* line, size_t from, size_t to, LineScan* scan);
+static int count_stars_range(const char* str, size_t from, size_t to);
+
+#ifdef SCAN_X86
+static void scan_line_sse2(const char* line, size_t from, size_t len, LineScan* scan);
+static int count_stars_sse2(const char* str, size_t len);
+#endif
+
+#ifdef SCAN_AVX2
+static void scan_line_avx2(const char* line, size_t len, LineScan* scan) AVX2_FUNCTION;
+static int count_stars_avx2(const char* str, size_t len) AVX2_FUNCTION;
+#endif
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Same as isspace() in the C locale
+static bool is_blank(unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Marks are few, one step per set bit is enough
+static int count_bits(unsigned int bits) {
+  int count = 0;
+
+  while (bits != 0) {
+    bits &= bits - 1;
+    count++;
+  }
+
+  return count;
+}
+
+// Adds the '=' and ':' of a block, one bit per byte from offset
+static void add_marks(LineScan* scan, size_t offset, unsigned int equals, unsigned int colons) {
+  if (equals != 0) {
+    if (scan->equal_count == 0) {
+      scan->equal = offset + __builtin_ctz(equals);
+    }
+    scan->equal_count += count_bits(equals);
+  }
+
+  if (colons != 0) {
+    if (scan->colon_count == 0) {
+      scan->colon = offset + __builtin_ctz(colons);
+    }
+    scan->colon_count += count_bits(colons);
+  }
+}
+
+// For what's left after the blocks, or whole lines elsewhere. Marks are
+// found with memchr(), which is vectorized by the C library.
+static void scan_range(const char* line, size_t from, size_t to, LineScan* scan) {
+  const char* end = line + to;
+  const char* found;
+
+  for (const char* p = line + from; (found = memchr(p, '=', end - p)) != NULL; p = found + 1) {
+    add_marks(scan, found - line, 1, 0);
+  }
+  for (const char* p = line + from; (found = memchr(p, ':', end - p)) != NULL; p = found + 1) {
+    add_marks(scan, found - line, 0, 1);
+  }
+
+  for (size_t i = from; i < to && scan->blank; i++) {
+    scan->blank = is_blank((unsigned char)line[i]);
+  }
+}
+
+static int count_stars_range(const char* str, size_t from, size_t to) {
+  int count = 0;
+
+  for (size_t i = from; i < to; i++) {
+    count += str[i] == '*';
+  }
+
+  return count;
+}
+
+#ifdef SCAN_X86
+
+// Scans line from offset from. Whitespace is ' ' or '\t' to '\r', that is
+// c - '\t' <= 4 unsigned.
+static void scan_line_sse2(const char* line, size_t from, size_t len, LineScan* scan) {
+  const __m128i equal = _mm_set1_epi8('=');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i four = _mm_set1_epi8(4);
+  size_t i = from;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(line + i));
+    __m128i equals = _mm_cmpeq_epi8(block, equal);
+    __m128i colons = _mm_cmpeq_epi8(block, colon);
+
+    if (scan->blank) {
+      __m128i control = _mm_sub_epi8(block, tab);
+      __m128i blanks = _mm_or_si128(_mm_cmpeq_epi8(block, space),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(control, four), control));
+      scan->blank = _mm_movemask_epi8(blanks) == 0xffff;
+    }
+    // Most blocks have neither, one test tells
+    if (_mm_movemask_epi8(_mm_or_si128(equals, colons)) != 0) {
+      add_marks(scan, i, (unsigned int)_mm_movemask_epi8(equals),
+                (unsigned int)_mm_movemask_epi8(colons));
+    }
+  }
+
+  scan_range(line, i, len, scan);
+}
+
+#ifdef SCAN_AVX2
+static void scan_line_avx2(const char* line, size_t len, LineScan* scan) {
+  const __m256i equal = _mm256_set1_epi8('=');
+  const __m256i colon = _mm256_set1_epi8(':');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i four = _mm256_set1_epi8(4);
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(line + i));
+    __m256i equals = _mm256_cmpeq_epi8(block, equal);
+    __m256i colons = _mm256_cmpeq_epi8(block, colon);
+
+    if (scan->blank) {
+      __m256i control = _mm256_sub_epi8(block, tab);
+      __m256i blanks = _mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                                       _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control));
+      scan->blank = (unsigned int)_mm256_movemask_epi8(blanks) == 0xffffffffu;
+    }
+    if (!_mm256_testz_si256(equals, equals) || !_mm256_testz_si256(colons, colons)) {
+      add_marks(scan, i, (unsigned int)_mm256_movemask_epi8(equals),
+                (unsigned int)_mm256_movemask_epi8(colons));
+    }
+  }
+
+  // GCC doesn't clear the upper halves on its own here, and leaving them
+  // dirty makes all the SSE code that runs after this slow
+  _mm256_zeroupper();
+  scan_line_sse2(line, i, len, scan);
+}
+#endif
+
+// Matches are added up per byte lane, 255 blocks at most so they can't
+// wrap, then summed by _mm_sad_epu8()
+static int count_stars_sse2(const char* str, size_t len) {
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i zero = _mm_setzero_si128();
+  int count = 0;
+  size_t i = 0;
+
+  while (i + 16 <= len) {
+    __m128i lanes = zero;
+
+    for (int blocks = 0; blocks < 255 && i + 16 <= len; blocks++, i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+      lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(block, star));
+    }
+
+    __m128i sums = _mm_sad_epu8(lanes, zero);
+    count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+  }
+
+  return count + count_stars_range(str, i, len);
+}
+
+#ifdef SCAN_AVX2
+static int count_stars_avx2(const char* str, size_t len) {
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i zero = _mm256_setzero_si256();
+  int count = 0;
+  size_t i = 0;
+
+  while (i + 32 <= len) {
+    __m256i lanes = zero;
+
+    for (int blocks = 0; blocks < 255 && i + 32 <= len; blocks++, i += 32) {
+      __m256i block = _mm256_loadu_si256((const __m256i*)(str + i));
+      lanes = _mm256_sub_epi8(lanes, _mm256_cmpeq_epi8(block, star));
+    }
+
+    uint64_t sums[4];
+    _mm256_storeu_si256((__m256i*)sums, _mm256_sad_epu8(lanes, zero));
+    count += (int)(sums[0] + sums[1] + sums[2] + sums[3]);
+  }
+
+  _mm256_zeroupper();
+  return count + count_stars_sse2(str + i, len - i);
+}
+#endif
+
+#endif
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+void scan_line(const char* line, size_t len, LineScan* scan) {
+  scan->equal = len;
+  scan->colon = len;
+  scan->equal_count = 0;
+  scan->colon_count = 0;
+  scan->blank = true;
+
+#if defined(SCAN_AVX2)
+  if (len >= 32 && __builtin_cpu_supports("avx2")) {
+    scan_line_avx2(line, len, scan);
+  } else {
+    scan_line_sse2(line, 0, len, scan);
+  }
+#elif defined(SCAN_X86)
+  scan_line_sse2(line, 0, len, scan);
+#else
+  scan_range(line, 0, len, scan);
+#endif
+}
+
+// Count '*' in a view
+int scan_count_stars(const char* str, size_t len) {
+#ifdef SCAN_X86
+#ifdef SCAN_AVX2
+  if (len >= 32 && __builtin_cpu_supports("avx2")) {
+    return count_stars_avx2(str, len);
+  }
+#endif
+  return count_stars_sse2(str, len);
+#else
+  return count_stars_range(str, 0, len);
+#endif
+}
@@ -0,0 +1,460 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "output.h"
+#include "pomofile.h"
+#include "registers.h"
+#include "serve.h"
+#include "subjects.h"
+#include "util.h"
+
+#define SERVER_THREADS 8
+#define QUERY_SIZE 4096
+#define MAX_QUERY_ARGS 64
+#define CLIENT_TIMEOUT_SECONDS 5
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+// The registers as they were after some reload, never changed once
+// published. Freed when the last query using it is done.
+typedef struct {
+  int refs;
+  DayIndex day_index;          // Own copies of the registers, sorted
+  HashMap* pomodoro_durations;
+} Snapshot;
+
+struct Server {
+  const char* path;
+  int fd;
+  bool stopping;
+  pthread_mutex_t lock;  // Only held to take or swap current
+  Snapshot* current;
+  pthread_t threads[SERVER_THREADS];
+  int thread_count;
+};
+
+typedef struct {
+  RegisterFilter filter;
+  const Exporter* exporter;
+  bool reverse;
+  bool summary;
+  int* subjects;  // Ids of the subjects asked for, sorted
+  int subject_count;
+} Query;
+
+static Snapshot* snapshot_create(ProcessData* process_data);
+static void snapshot_release(Snapshot* snapshot);
+static Snapshot* snapshot_acquire(Server* server);
+static int split_query(char* line, char** args, int max_args);
+static int parse_query(Query* query, char** args, int count);
+static int compare_ids(const void* a, const void* b);
+static bool is_asked_subject(int subject, void* query);
+static void run_query(Snapshot* snapshot, Query* query);
+static void serve_client(Server* server, int fd);
+static void* server_main(void* arg);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Copies the dates that have registers. Date strings and durations are
+// shared, they are kept for the whole run and never change.
+static Snapshot* snapshot_create(ProcessData* process_data) {
+  Snapshot* snapshot = calloc(1, sizeof(Snapshot));
+  if (!snapshot) return NULL;
+
+  snapshot->refs = 1;
+  day_index_init(&snapshot->day_index);
+  snapshot->pomodoro_durations = hashmap_create(64, 0.75);
+  if (!snapshot->pomodoro_durations) {
+    snapshot_release(snapshot);
+    return NULL;
+  }
+
+  DayIndex* day_index = &process_data->day_index;
+  day_index_sort(day_index);
+
+  for (int i = 0; i < day_index->size; i++) {
+    DayEntry* entry = &day_index->days[i];
+    if (register_map_size(entry->registers) == 0) continue;
+
+    RegisterMap* copy = register_map_create(register_map_size(entry->registers) * 2, 0.75);
+    if (!copy || day_index_add(&snapshot->day_index, entry->day, entry->date, copy) != 0) {
+      register_map_destroy(copy);
+      snapshot_release(snapshot);
+      return NULL;
+    }
+
+    register_map_merge(copy, entry->registers);
+    hashmap_put(snapshot->pomodoro_durations, entry->date,
+                hashmap_get(process_data->pomodoro_durations, entry->date));
+  }
+
+  return snapshot;
+}
+
+static void snapshot_release(Snapshot* snapshot) {
+  if (!snapshot || __atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_ACQ_REL) > 0) return;
+
+  for (int i = 0; i < snapshot->day_index.size; i++) {
+    register_map_destroy(snapshot->day_index.days[i].registers);
+  }
+  day_index_free(&snapshot->day_index);
+  hashmap_destroy(snapshot->pomodoro_durations, NULL);
+  free(snapshot);
+}
+
+static Snapshot* snapshot_acquire(Server* server) {
+  pthread_mutex_lock(&server->lock);
+  Snapshot* snapshot = server->current;
+  __atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&server->lock);
+
+  return snapshot;
+}
+
+// Splits at blanks, "double quotes" keep blanks in. Returns how many
+// arguments there are, -1 if too many.
+static int split_query(char* line, char** args, int max_args) {
+  int count = 0;
+  char* read = line;
+
+  while (*read != '\0') {
+    while (*read == ' ' || *read == '\t' || *read == '\r') read++;
+    if (*read == '\0') break;
+    if (count == max_args) return -1;
+
+    char* write = read;
+    args[count++] = write;
+    bool quoted = false;
+
+    for (; *read != '\0' && (quoted || (*read != ' ' && *read != '\t' && *read != '\r')); read++) {
+      if (*read == '"') {
+        quoted = !quoted;
+      } else {
+        *write++ = *read;
+      }
+    }
+
+    if (*read != '\0') read++;
+    *write = '\0';
+  }
+
+  return count;
+}
+
+// Same options as the command line has for them. Errors go to the client.
+static int parse_query(Query* query, char** args, int count) {
+  for (int i = 0; i < count; i++) {
+    const char* opt = args[i];
+    bool has_value = i + 1 < count;
+
+    if ((strcmp(opt, "-a") == 0 || strcmp(opt, "-b") == 0) && has_value) {
+      int day = string_to_day(args[++i]);
+      if (day == DAY_INVALID) {
+        output_string("Error: Invalid date format for option '");
+        output_string(opt);
+        output_string("'\nExpected format: \"DD/MM/YYYY\"\n");
+        return -1;
+      }
+
+      if (opt[1] == 'a') {
+        query->filter.aftdate_flag = true;
+        query->filter.after_date = day;
+      } else {
+        query->filter.befdate_flag = true;
+        query->filter.before_date = day;
+      }
+    }
+    else if (strcmp(opt, "-s") == 0 && has_value) {
+      int names;
+      char** subjects = split_string(NULL, args[++i], ',', &names);
+
+      free(query->subjects);
+      query->subjects = malloc(sizeof(int) * (names + 1));
+      query->subject_count = 0;
+      query->filter.subj_flag = true;
+
+      // Names never seen can't match anything
+      for (int n = 0; query->subjects && n < names; n++) {
+        int id = subject_find(subjects[n], strlen(subjects[n]));
+        if (id != -1) query->subjects[query->subject_count++] = id;
+      }
+      free_string_array(subjects);
+
+      if (!query->subjects) {
+        output_string("Error: out of memory\n");
+        return -1;
+      }
+      qsort(query->subjects, query->subject_count, sizeof(int), compare_ids);
+    }
+    else if (strcmp(opt, "-e") == 0 && has_value) {
+      query->exporter = exporter_find(args[++i]);
+      if (!query->exporter) {
+        output_string("Error: option -e requires a valid file type to export\n");
+        return -1;
+      }
+    }
+    else if (strcmp(opt, "-r") == 0) {
+      query->reverse = true;
+    }
+    else if (strcmp(opt, "--summary") == 0) {
+      query->summary = true;
+    }
+    else {
+      output_string("Error: Unknown query option '");
+      output_string(opt);
+      output_string("'\n");
+      return -1;
+    }
+  }
+
+  if (query->filter.aftdate_flag && query->filter.befdate_flag &&
+      query->filter.after_date > query->filter.before_date) {
+    output_string("Error: After date cannot be later than before date\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+static int compare_ids(const void* a, const void* b) {
+  int id_a = *(const int*)a;
+  int id_b = *(const int*)b;
+
+  return (id_a > id_b) - (id_a < id_b);
+}
+
+static bool is_asked_subject(int subject, void* query) {
+  Query* asked = (Query*)query;
+  return bsearch(&subject, asked->subjects, asked->subject_count, sizeof(int), compare_ids) != NULL;
+}
+
+// Prints the report through the same filter and exporters as a normal run,
+// on a copy of the process data that only reads the snapshot
+static void run_query(Snapshot* snapshot, Query* query) {
+  ProcessData view;
+  memset(&view, 0, sizeof(view));
+  view.pomodoro_durations = snapshot->pomodoro_durations;
+  view.day_index = snapshot->day_index;
+  view.register_filter = query->filter;
+  view.exporter = query->exporter;
+
+  int first, end;
+  filter_registers(&view, &first, &end);
+
+  // Subjects are filtered while parsing in a normal run, here on copies of
+  // the dates in range
+  DayIndex filtered;
+  day_index_init(&filtered);
+  if (query->filter.subj_flag) {
+    for (int i = first; i < end; i++) {
+      DayEntry* entry = &view.day_index.days[i];
+      RegisterMap* copy = register_map_create(16, 0.75);
+      if (!copy || day_index_add(&filtered, entry->day, entry->date, copy) != 0) {
+        register_map_destroy(copy);
+        continue;
+      }
+
+      register_map_merge(copy, entry->registers);
+      register_map_retain(copy, is_asked_subject, query);
+    }
+
+    view.day_index = filtered;
+    first = 0;
+    end = filtered.size;
+  }
+
+  if (query->summary) {
+    print_summary(&view, first, end);
+  } else {
+    view.exporter->begin();
+    print_dates(&view, first, end, query->reverse);
+    view.exporter->end();
+  }
+
+  for (int i = 0; i < filtered.size; i++) {
+    register_map_destroy(filtered.days[i].registers);
+  }
+  day_index_free(&filtered);
+}
+
+// Reads one line of options and writes the report back
+static void serve_client(Server* server, int fd) {
+  struct timeval timeout = {CLIENT_TIMEOUT_SECONDS, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  char line[QUERY_SIZE];
+  size_t used = 0;
+  while (used < sizeof(line) - 1 && memchr(line, '\n', used) == NULL) {
+    ssize_t n = read(fd, line + used, sizeof(line) - 1 - used);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    used += (size_t)n;
+  }
+  line[used] = '\0';
+  line[strcspn(line, "\n")] = '\0';
+
+  if (output_redirect(fd) != 0) {
+    close(fd);
+    return;
+  }
+
+  char* args[MAX_QUERY_ARGS];
+  int count = split_query(line, args, MAX_QUERY_ARGS);
+  Query query;
+  memset(&query, 0, sizeof(query));
+  query.exporter = exporter_find("text");
+
+  if (count < 0) {
+    output_string("Error: too many query options\n");
+  } else if (parse_query(&query, args, count) == 0) {
+    Snapshot* snapshot = snapshot_acquire(server);
+    run_query(snapshot, &query);
+    snapshot_release(snapshot);
+  }
+
+  free(query.subjects);
+  output_redirect(-1);
+  close(fd);
+}
+
+static void* server_main(void* arg) {
+  Server* server = (Server*)arg;
+
+  while (!__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE)) {
+    int fd = accept(server->fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      if (!__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE)) {
+        fprintf(stderr, "Error: cannot accept queries on '%s'\n", server->path);
+      }
+      break;
+    }
+
+    serve_client(server, fd);
+  }
+
+  return NULL;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// NULL if the socket can't be set up. A socket left by an earlier run is
+// replaced, unless some server still answers on it.
+Server* server_start(const char* path, ProcessData* process_data) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "Error: socket path '%s' is too long\n", path);
+    return NULL;
+  }
+  strcpy(address.sun_path, path);
+
+  Server* server = calloc(1, sizeof(Server));
+  if (!server) return NULL;
+
+  server->path = path;
+  server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server->fd < 0) {
+    fprintf(stderr, "Error: cannot create socket '%s'\n", path);
+    free(server);
+    return NULL;
+  }
+
+  struct stat file_info;
+  if (stat(path, &file_info) == 0 && S_ISSOCK(file_info.st_mode)) {
+    if (connect(server->fd, (struct sockaddr*)&address, sizeof(address)) == 0) {
+      fprintf(stderr, "Error: another server is using '%s'\n", path);
+      close(server->fd);
+      free(server);
+      return NULL;
+    }
+    unlink(path);
+  }
+
+  if (bind(server->fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      listen(server->fd, SOMAXCONN) != 0) {
+    fprintf(stderr, "Error: cannot listen on '%s'\n", path);
+    close(server->fd);
+    free(server);
+    return NULL;
+  }
+
+  server->current = snapshot_create(process_data);
+  if (!server->current) {
+    fprintf(stderr, "Error: cannot take a snapshot of the registers\n");
+    close(server->fd);
+    unlink(path);
+    free(server);
+    return NULL;
+  }
+
+  // A client gone before its report is done must not end the server
+  signal(SIGPIPE, SIG_IGN);
+  pthread_mutex_init(&server->lock, NULL);
+
+  for (int i = 0; i < SERVER_THREADS; i++) {
+    if (pthread_create(&server->threads[i], NULL, server_main, server) != 0) break;
+    server->thread_count++;
+  }
+
+  if (server->thread_count == 0) {
+    fprintf(stderr, "Error: cannot start the server threads\n");
+    server_stop(server);
+    return NULL;
+  }
+
+  return server;
+}
+
+// Swaps in the registers as they are now. Queries already running finish
+// on the snapshot they started with.
+void server_publish(Server* server, ProcessData* process_data) {
+  Snapshot* snapshot = snapshot_create(process_data);
+  if (!snapshot) {
+    fprintf(stderr, "Error: cannot take a snapshot of the registers, serving the last one\n");
+    return;
+  }
+
+  pthread_mutex_lock(&server->lock);
+  Snapshot* old = server->current;
+  server->current = snapshot;
+  pthread_mutex_unlock(&server->lock);
+
+  snapshot_release(old);
+}
+
+// Waits for the queries being answered and removes the socket
+void server_stop(Server* server) {
+  if (!server) return;
+
+  __atomic_store_n(&server->stopping, true, __ATOMIC_RELEASE);
+  shutdown(server->fd, SHUT_RDWR); // Wakes the threads blocked in accept()
+
+  for (int i = 0; i < server->thread_count; i++) {
+    pthread_join(server->threads[i], NULL);
+  }
+
+  close(server->fd);
+  unlink(server->path);
+  snapshot_release(server->current);
+  pthread_mutex_destroy(&server->lock);
+  free(server);
+}
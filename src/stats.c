@@ -0,0 +1,82 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include "stats.h"
+
+Stats stats;
+
+static pthread_mutex_t seconds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static double now(void);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// Start of a phase, for stats_stop()
+double stats_start(void) {
+  return stats.enabled ? now() : 0;
+}
+
+// Phases running on several threads add up the time of each
+void stats_stop(StatsPhase phase, double start) {
+  if (stats.enabled) {
+    double seconds = now() - start;
+
+    pthread_mutex_lock(&seconds_lock);
+    stats.seconds[phase] += seconds;
+    pthread_mutex_unlock(&seconds_lock);
+  }
+}
+
+void stats_print(void) {
+  if (!stats.enabled) return;
+
+  double total = 0;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    total += stats.seconds[i];
+  }
+
+  fprintf(stderr, "\nStats:\n"
+                  "  parse              %10.6f s\n"
+                  "  merge              %10.6f s\n"
+                  "  filter             %10.6f s\n"
+                  "  render             %10.6f s\n"
+                  "  total              %10.6f s\n"
+                  "  files              %10lld\n"
+                  "  files out of range %10lld\n"
+                  "  lines              %10lld\n"
+                  "  includes           %10lld\n"
+                  "  registers created  %10lld\n"
+                  "  registers merged   %10lld\n"
+                  "  hashmap resizes    %10lld\n"
+                  "  bytes written      %10lld\n",
+                  stats.seconds[PHASE_PARSE],
+                  stats.seconds[PHASE_MERGE],
+                  stats.seconds[PHASE_FILTER],
+                  stats.seconds[PHASE_RENDER],
+                  total,
+                  stats.files,
+                  stats.files_out_of_range,
+                  stats.lines,
+                  stats.includes,
+                  stats.registers_created,
+                  stats.registers_merged,
+                  stats.hashmap_resizes,
+                  stats.bytes_written);
+}
@@ -0,0 +1,224 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _POSIX_C_SOURCE 200809L // For pthread_rwlock_t
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "subjects.h"
+
+#define INITIAL_SLOTS 64
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+typedef struct {
+  pthread_rwlock_t lock;
+  char** names;           // id -> name
+  char*** retired;        // Smaller names arrays, readers may still hold them
+  int retired_count;
+  unsigned long* hashes;  // id -> hash of its name
+  int count;
+  int capacity;
+  int* slots;             // Open addressing, id or -1
+  int slot_capacity;      // Power of two
+} SubjectTable;
+
+static SubjectTable table;
+
+static unsigned long hash(const char* str, size_t len);
+static int lookup(const char* name, size_t len, unsigned long name_hash);
+static void place(int id);
+static int grow_slots(void);
+static int add_subject(const char* name, size_t len, unsigned long name_hash);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Hash function(FNV-1a, 64 bits), same as HashMap's
+static unsigned long hash(const char* str, size_t len) {
+  unsigned long long hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)str[i];
+    hash *= 1099511628211ULL;
+  }
+
+  hash ^= hash >> 32;
+  return (unsigned long)hash;
+}
+
+// Id of a name, -1 if it wasn't interned. Needs the lock.
+static int lookup(const char* name, size_t len, unsigned long name_hash) {
+  int mask = table.slot_capacity - 1;
+
+  for (int index = (int)(name_hash & mask); table.slots[index] != -1; index = (index + 1) & mask) {
+    int id = table.slots[index];
+
+    if (table.hashes[id] == name_hash && strncmp(table.names[id], name, len) == 0 && table.names[id][len] == '\0') {
+      return id;
+    }
+  }
+
+  return -1;
+}
+
+static void place(int id) {
+  int mask = table.slot_capacity - 1;
+  int index = (int)(table.hashes[id] & mask);
+
+  while (table.slots[index] != -1) {
+    index = (index + 1) & mask;
+  }
+
+  table.slots[index] = id;
+}
+
+static int grow_slots(void) {
+  int* slots = malloc(sizeof(int) * table.slot_capacity * 2);
+  if (!slots) return -1;
+
+  free(table.slots);
+  table.slots = slots;
+  table.slot_capacity *= 2;
+  memset(table.slots, -1, sizeof(int) * table.slot_capacity);
+
+  for (int id = 0; id < table.count; id++) {
+    place(id);
+  }
+
+  return 0;
+}
+
+// Needs the write lock
+static int add_subject(const char* name, size_t len, unsigned long name_hash) {
+  if (table.count == table.capacity) {
+    // Not realloc'd, subject_name() may be reading the old array
+    int capacity = table.capacity * 2;
+    char** names = malloc(sizeof(char*) * capacity);
+    if (!names) return -1;
+
+    // Growing these leaves the table as it was, names is only published
+    // once both succeed
+    char*** retired = realloc(table.retired, sizeof(char**) * (table.retired_count + 1));
+    if (!retired) {
+      free(names);
+      return -1;
+    }
+    table.retired = retired;
+
+    unsigned long* hashes = realloc(table.hashes, sizeof(unsigned long) * capacity);
+    if (!hashes) {
+      free(names);
+      return -1;
+    }
+    table.hashes = hashes;
+
+    memcpy(names, table.names, sizeof(char*) * table.count);
+    table.retired[table.retired_count++] = table.names;
+    __atomic_store_n(&table.names, names, __ATOMIC_RELEASE);
+    table.capacity = capacity;
+  }
+
+  // Keep at most half of the slots used
+  if ((table.count + 1) * 2 > table.slot_capacity && grow_slots() != 0) {
+    return -1;
+  }
+
+  char* copy = malloc(len + 1);
+  if (!copy) return -1;
+  memcpy(copy, name, len);
+  copy[len] = '\0';
+
+  int id = table.count;
+  table.names[id] = copy;
+  table.hashes[id] = name_hash;
+  place(id);
+  __atomic_store_n(&table.count, id + 1, __ATOMIC_RELEASE);
+
+  return id;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+int subjects_init(void) {
+  table.count = 0;
+  table.retired = NULL;
+  table.retired_count = 0;
+  table.capacity = INITIAL_SLOTS / 2;
+  table.slot_capacity = INITIAL_SLOTS;
+  table.names = malloc(sizeof(char*) * table.capacity);
+  table.hashes = malloc(sizeof(unsigned long) * table.capacity);
+  table.slots = malloc(sizeof(int) * table.slot_capacity);
+
+  if (!table.names || !table.hashes || !table.slots) {
+    subjects_free();
+    return -1;
+  }
+
+  memset(table.slots, -1, sizeof(int) * table.slot_capacity);
+  pthread_rwlock_init(&table.lock, NULL);
+  return 0;
+}
+
+void subjects_free(void) {
+  if (table.names) {
+    for (int id = 0; id < table.count; id++) {
+      free(table.names[id]);
+    }
+    pthread_rwlock_destroy(&table.lock);
+  }
+
+  for (int i = 0; i < table.retired_count; i++) {
+    free(table.retired[i]);
+  }
+  free(table.retired);
+  free(table.names);
+  free(table.hashes);
+  free(table.slots);
+  memset(&table, 0, sizeof(table));
+}
+
+// Id of a name, added to the table if it's new. -1 if out of memory.
+int subject_intern(const char* name, size_t len) {
+  unsigned long name_hash = hash(name, len);
+
+  // Most names are already there, look them up without blocking other readers
+  pthread_rwlock_rdlock(&table.lock);
+  int id = lookup(name, len, name_hash);
+  pthread_rwlock_unlock(&table.lock);
+
+  if (id != -1) {
+    return id;
+  }
+
+  pthread_rwlock_wrlock(&table.lock);
+  id = lookup(name, len, name_hash); // Someone else may have added it
+  if (id == -1) {
+    id = add_subject(name, len, name_hash);
+  }
+  pthread_rwlock_unlock(&table.lock);
+
+  return id;
+}
+
+// Id of a name, -1 if it was never interned
+int subject_find(const char* name, size_t len) {
+  pthread_rwlock_rdlock(&table.lock);
+  int id = lookup(name, len, hash(name, len));
+  pthread_rwlock_unlock(&table.lock);
+
+  return id;
+}
+
+// Names don't move once interned and the arrays holding them are kept
+// until subjects_free(), so it's safe while other threads intern
+const char* subject_name(int id) {
+  if (id < 0 || id >= __atomic_load_n(&table.count, __ATOMIC_ACQUIRE)) return NULL;
+  return __atomic_load_n(&table.names, __ATOMIC_ACQUIRE)[id];
+}
+
+int subject_count(void) {
+  return __atomic_load_n(&table.count, __ATOMIC_ACQUIRE);
+}
@@ -4,6 +4,7 @@
  * 
  * See LICENSE file for full BSD 3-Clause license terms.
  */
+#define _POSIX_C_SOURCE 200809L // For localtime_r
 #include <ctype.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -15,7 +16,13 @@
 #include <sys/stat.h>
 #include "util.h"
 
-char** split_string(const char* str, const char delimiter, int* count) {
+// Allocations of the helpers below come from the arena when one is given,
+// from malloc() otherwise
+static void* allocate(Arena* arena, size_t size) {
+  return arena ? arena_alloc(arena, size) : malloc(size);
+}
+
+char** split_string(Arena* arena, const char* str, const char delimiter, int* count) {
   // Check for valid input
   if (str == NULL) {
     *count = 0;
@@ -26,8 +33,10 @@ char** split_string(const char* str, const char delimiter, int* count) {
   if (len == 0) {
     *count = 0;
     // Returns an empty array
-    char** result = malloc(sizeof(char*));
-    result[0] = NULL;
+    char** result = allocate(arena, sizeof(char*));
+    if (result != NULL) {
+      result[0] = NULL;
+    }
     return result;
   }
 
@@ -40,7 +49,7 @@ char** split_string(const char* str, const char delimiter, int* count) {
   }
 
   // Allocate an array of pointers to strings
-  char** result = malloc((parts + 1) * sizeof(char*)); // +1 for NULL at the end
+  char** result = allocate(arena, (parts + 1) * sizeof(char*)); // +1 for NULL at the end
   if (result == NULL) {
     *count = 0;
     return NULL;
@@ -55,14 +64,16 @@ char** split_string(const char* str, const char delimiter, int* count) {
       int substr_len = i - start;
 
       // Allocate memory for substring
-      result[current_part] = malloc((substr_len + 1) * sizeof(char));
+      result[current_part] = allocate(arena, (substr_len + 1) * sizeof(char));
       if (result[current_part] == NULL) {
-        // Free memory in case of error
-        for (int j = 0; j < current_part; j++) {
-          free(result[j]);
-        }
+        // Free memory in case of error, the arena keeps it until it's freed
+        if (arena == NULL) {
+          for (int j = 0; j < current_part; j++) {
+            free(result[j]);
+          }
 
-        free(result);
+          free(result);
+        }
         *count = 0;
         return NULL;
       }
@@ -86,7 +97,8 @@ char** split_string(const char* str, const char delimiter, int* count) {
   return result;
 }
 
-// Frees an array of strings. The last element should be NULL.
+// Frees an array of strings. The last element should be NULL. Only for
+// arrays split without an arena.
 void free_string_array(char** array) {
   if (array == NULL) return;
 
@@ -97,105 +109,33 @@ void free_string_array(char** array) {
   free(array);
 }
 
-// Count '*' in a string
-int count_stars(const char* str) {
-  if (str == NULL) {
-    return 0;
-  }
-
-  int count = 0;
-  int len = strlen(str);
-  for (int i = 0; i < len; i++) {
-    if (str[i] == '*') {
-      count++;
-    }
-  }
-
-  return count;
-}
-
-// Removes the specified 'chars' from the beginning and end of
-// the string. The default is to remove white spaces.
-char* strip_string(const char* str, const char* chars) {
-  if (str == NULL) return NULL;
-
-  bool use_default = (chars == NULL || *chars == '\0');
-  const char* start = str;
-  const char* end = str + strlen(str) - 1;
-
-  // Find the beginning
-  while (*start) {
-    bool remove = false;
-    if (use_default) {
-      remove = (*start == ' ' || *start == '\t' || *start == '\n' ||
-                *start == '\r' || *start == '\f' || *start == '\v');
-    } else {
-      for (const char* p = chars; *p; p++) {
-        if (*p == *start) {
-          remove = true;
-          break;
-        }
-      }
-    }
+// Trims whitespaces from both sides of a view, updating its length
+const char* trim_view(const char* str, size_t* len) {
+  size_t start = 0;
+  size_t end = *len;
 
-    if (!remove) break;
+  while (start < end && isspace((unsigned char) str[start])) {
     start++;
   }
-
-  // Find the end
-  while (end > start) {
-    bool remove = false;
-    if (use_default) {
-      remove = (*end == ' ' || *end == '\t' || *end == '\n' ||
-                *end == '\r' || *end == '\f' || *end == '\v');
-    } else {
-      for (const char* p = chars; *p; p++) {
-        if (*p == *end) {
-          remove = true;
-          break;
-        }
-      }
-    }
-
-    if (!remove) break;
+  while (end > start && isspace((unsigned char) str[end - 1])) {
     end--;
   }
 
-  // Allocate new string
-  size_t len = (end >= start) ? (end - start + 1) : 0;
-  char* result = malloc(len+1);
+  *len = end - start;
+  return str + start;
+}
+
+// Copies a view into a new NUL terminated string
+char* string_from_view(Arena* arena, const char* str, size_t len) {
+  char* result = allocate(arena, len + 1);
   if (result == NULL) return NULL;
 
-  if (len > 0) {
-    memcpy(result, start, len);
-  }
+  memcpy(result, str, len);
   result[len] = '\0';
 
   return result;
 }
 
-// Trim whitespaces from the left
-char* trim_left(char* str) {
-  while (isspace((unsigned char) *str)) {
-    str++;
-  }
-
-  return str;
-}
-
-char* int_to_string(int n) {
-  int length = snprintf(NULL, 0, "%d", n);
-
-  char* str = malloc(length + 1);
-  if (str == NULL) {
-    return NULL;
-  }
-
-  snprintf(str, length+1, "%d", n);
-
-  return str;
-}
-
 int string_to_int(const char* str) {
   char* endptr;
   errno = 0;
@@ -224,38 +164,6 @@ int string_to_int(const char* str) {
   return (int)val;
 }
 
-bool is_empty_str(const char *str) {
-  while (*str) {
-    if (!isspace((unsigned char) *str)) {
-      return false;
-    }
-    str++;
-  }
-  return true;
-}
-
-bool is_comment(const char *str) {
-  while (isspace((unsigned char)*str)) {
-    str++;
-  }
-
-  return (*str == '#');
-}
-
-bool string_arr_contains(char** array, const char* string) {
-  if (!array || !string) return false;
-
-  bool contains = false;
-  for (int i = 0; array[i] != NULL; i++) {
-    if (strcmp(array[i], string) == 0) {
-      contains = true;
-      break;
-    }
-  }
-
-  return contains;
-}
-
 static bool is_leap_year(int y) {
   bool div4 = y % 4 == 0;
   bool div400 = y % 400 == 0;
@@ -302,20 +210,49 @@ static bool is_valid_date(int day, int month, int year) {
   return true;
 }
 
-time_t string_to_time(const char *str) {
-  struct tm time = {0};
-  int d, m, y;
+static bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Reads an int the way sscanf's %d does: blanks, then an optional sign and
+// digits. Values too big for a date saturate instead of overflowing.
+static const char* scan_int(const char* str, int* value) {
+  while (isspace((unsigned char)*str)) str++;
 
-  if (sscanf(str, "%d/%d/%d", &d, &m, &y) != 3) {
-    return (time_t)-1; 
+  bool negative = *str == '-';
+  if (*str == '-' || *str == '+') str++;
+  if (!is_digit(*str)) return NULL;
+
+  int n = 0;
+  for (; is_digit(*str); str++) {
+    if (n < 100000) n = n * 10 + (*str - '0');
   }
 
-  if (!is_valid_day(d) || !is_valid_month(m) || !is_valid_year(y)) {
-    return (time_t)-1;
-  } 
+  *value = negative ? -n : n;
+  return str;
+}
+
+// Day number of a "dd/mm/yyyy" date, or DAY_INVALID. Years 0 to 69 are
+// taken as 2000 to 2069 and 70 to 99 as 1970 to 1999. Anything after the
+// year is ignored. Reentrant, no time zone involved.
+int string_to_day(const char* str) {
+  int d, m, y;
+
+  // Most dates are written in full, "dd/mm/yyyy"
+  if (str && is_digit(str[0]) && is_digit(str[1]) && str[2] == '/' &&
+      is_digit(str[3]) && is_digit(str[4]) && str[5] == '/' &&
+      is_digit(str[6]) && is_digit(str[7]) && is_digit(str[8]) && is_digit(str[9]) &&
+      !is_digit(str[10])) {
+    d = (str[0] - '0') * 10 + (str[1] - '0');
+    m = (str[3] - '0') * 10 + (str[4] - '0');
+    y = (str[6] - '0') * 1000 + (str[7] - '0') * 100 + (str[8] - '0') * 10 + (str[9] - '0');
+  } else if (!str || !(str = scan_int(str, &d)) || *str++ != '/' ||
+      !(str = scan_int(str, &m)) || *str++ != '/' || !scan_int(str, &y)) {
+    return DAY_INVALID;
+  }
 
   if (!is_valid_date(d, m, y)) {
-    return (time_t)-1;
+    return DAY_INVALID;
   }
 
   if (y >= 0 && y < 100 ) {
@@ -323,28 +260,69 @@ time_t string_to_time(const char *str) {
      y += (y < 70) ? 2000 : 1900;
   }
 
-  time.tm_mday = d;
-  time.tm_mon = m - 1; // Adjust to 0-11  
-  time.tm_year = y - 1900; // Years since 1900
-  time.tm_isdst = -1;
+  return days_from_civil(y, m, d);
+}
 
-  time_t result = mktime(&time);
+// Writes the "dd/mm/yyyy" date of a day number to a buffer of
+// DATE_STRING_SIZE bytes and returns it
+char* day_to_string(int day, char* buffer) {
+  int year, month, mday;
+  civil_from_days(day, &year, &month, &mday);
+
+  if (year < 1000 || year > 9999) {
+    snprintf(buffer, DATE_STRING_SIZE, "%02d/%02d/%d", mday, month, year);
+    return buffer;
+  }
+
+  buffer[0] = '0' + mday / 10;
+  buffer[1] = '0' + mday % 10;
+  buffer[2] = '/';
+  buffer[3] = '0' + month / 10;
+  buffer[4] = '0' + month % 10;
+  buffer[5] = '/';
+  buffer[6] = '0' + year / 1000;
+  buffer[7] = '0' + year / 100 % 10;
+  buffer[8] = '0' + year / 10 % 10;
+  buffer[9] = '0' + year % 10;
+  buffer[10] = '\0';
+  return buffer;
+}
 
-  if (result == (time_t)-1) {
-    return (time_t)-1;
-  }
+// Days since 01/01/1970 of a date in the proleptic Gregorian calendar
+int days_from_civil(int year, int month, int day) {
+  // Count years from March, so the leap day is the last one of the year
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  int year_of_era = year - era * 400;
+  int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
 
-  return result;
+  return era * 146097 + day_of_era - 719468;
 }
 
-char* time_to_string(time_t time) {
-  struct tm* t = localtime(&time);
-  char* buffer = malloc(80 * sizeof(char));
-  if (buffer == NULL) {
-    return NULL;
+// Date of a day number, the inverse of days_from_civil()
+void civil_from_days(int days, int* year, int* month, int* day) {
+  days += 719468;
+  int era = (days >= 0 ? days : days - 146096) / 146097;
+  int day_of_era = days - era * 146097;
+  int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+  int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  int month_from_march = (5 * day_of_year + 2) / 153;
+
+  *day = day_of_year - (153 * month_from_march + 2) / 5 + 1;
+  *month = month_from_march < 10 ? month_from_march + 3 : month_from_march - 9;
+  *year = year_of_era + era * 400 + (*month <= 2);
+}
+
+// Day number of the local date of a time
+int time_to_day(time_t time) {
+  struct tm t;
+
+  if (localtime_r(&time, &t) == NULL) {
+    return 0;
   }
-  strftime(buffer, 80, "%d/%m/%Y", t);
-  return buffer;
+
+  return days_from_civil(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
 }
 
 time_t get_file_mod_date(const char* path) {
@@ -361,23 +339,6 @@ time_t get_file_mod_date(const char* path) {
   return modtime;
 }
 
-void print_file(const char* path) {
-  FILE* f = fopen(path, "r");
-  if (f == NULL) {
-    fprintf(stderr, "Error: cannot read '%s'\n", path);
-    return ;
-  }
-
-  char buffer[1024];
-  while (fgets(buffer, sizeof(buffer), f) != NULL) {
-    buffer[strcspn(buffer, "\n")] = '\0';
-
-    printf("%s\n", buffer);
-  }
-
-  fclose(f);
-}
-
 // This function extracts the directory from a path
 void extract_directory(const char *path, char *dir_buff, size_t buffer_size) {
   if (path == NULL || dir_buff == NULL) {
@@ -0,0 +1,310 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _DEFAULT_SOURCE // For d_type
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "util.h"
+#include "walk.h"
+
+#define EXTENSION ".pf"
+#define EXTENSION_LENGTH (sizeof(EXTENSION) - 1)
+
+// A directory to read, and which of the given ones it's under
+typedef struct {
+  char* path;
+  int source;
+} PendingDirectory;
+
+struct Walker {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;  // Directories queued, or the walk ended
+  PendingDirectory* pending; // Directories still to read, a stack
+  int pending_count;
+  int pending_capacity;
+  int active;              // Directories being read
+  int running;             // Threads that haven't finished
+  InputList* list;
+  pthread_t* threads;
+  int thread_count;
+};
+
+// Names read from one directory
+typedef struct {
+  char** names;
+  int count;
+  int capacity;
+} NameList;
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+static int push_directory(Walker* walker, const char* path, size_t len, int source);
+static void add_name(NameList* names, const char* name);
+static void free_names(NameList* names);
+static int compare_names(const void* a, const void* b);
+static bool has_extension(const char* name);
+static char* join_path(const char* dir, const char* name, size_t* len);
+static void read_directory(Walker* walker, const PendingDirectory* directory);
+static void* walker_main(void* arg);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+// Needs the lock
+static int push_directory(Walker* walker, const char* path, size_t len, int source) {
+  if (walker->pending_count == walker->pending_capacity) {
+    int capacity = walker->pending_capacity > 0 ? walker->pending_capacity * 2 : 64;
+    PendingDirectory* pending = realloc(walker->pending, sizeof(PendingDirectory) * capacity);
+    if (!pending) return -1;
+
+    walker->pending = pending;
+    walker->pending_capacity = capacity;
+  }
+
+  char* copy = string_from_view(NULL, path, len);
+  if (!copy) return -1;
+
+  walker->pending[walker->pending_count].path = copy;
+  walker->pending[walker->pending_count].source = source;
+  walker->pending_count++;
+  return 0;
+}
+
+static void add_name(NameList* names, const char* name) {
+  if (names->count == names->capacity) {
+    int capacity = names->capacity > 0 ? names->capacity * 2 : 64;
+    char** list = realloc(names->names, sizeof(char*) * capacity);
+    if (!list) return;
+
+    names->names = list;
+    names->capacity = capacity;
+  }
+
+  char* copy = string_from_view(NULL, name, strlen(name));
+  if (copy) {
+    names->names[names->count++] = copy;
+  }
+}
+
+static void free_names(NameList* names) {
+  for (int i = 0; i < names->count; i++) {
+    free(names->names[i]);
+  }
+  free(names->names);
+}
+
+static int compare_names(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static bool has_extension(const char* name) {
+  size_t len = strlen(name);
+  return len > EXTENSION_LENGTH && strcmp(name + len - EXTENSION_LENGTH, EXTENSION) == 0;
+}
+
+static char* join_path(const char* dir, const char* name, size_t* len) {
+  size_t dir_len = strlen(dir);
+  size_t name_len = strlen(name);
+  bool slash = dir_len > 0 && dir[dir_len - 1] != '/';
+
+  char* path = malloc(dir_len + slash + name_len + 1);
+  if (!path) return NULL;
+
+  memcpy(path, dir, dir_len);
+  if (slash) path[dir_len] = '/';
+  memcpy(path + dir_len + slash, name, name_len + 1);
+
+  *len = dir_len + slash + name_len;
+  return path;
+}
+
+// Adds the .pf files of a directory to the list, sorted by name, and queues
+// its subdirectories. Hidden entries are skipped, and so are links to
+// directories, which could make the walk loop.
+static void read_directory(Walker* walker, const PendingDirectory* directory) {
+  const char* path = directory->path;
+  int fd = openat(AT_FDCWD, path, O_RDONLY | O_DIRECTORY);
+  DIR* dir = fd >= 0 ? fdopendir(fd) : NULL;
+
+  if (dir == NULL) {
+    if (fd >= 0) close(fd);
+    fprintf(stderr, "Error: cannot read directory '%s'\n", path);
+    return;
+  }
+
+  NameList files = {NULL, 0, 0};
+  NameList subdirs = {NULL, 0, 0};
+  struct dirent* entry;
+
+  while ((entry = readdir(dir)) != NULL) {
+    const char* name = entry->d_name;
+    if (name[0] == '.') continue;
+
+    bool is_file = false;
+    bool is_dir = false;
+#ifdef _DIRENT_HAVE_D_TYPE
+    is_file = entry->d_type == DT_REG;
+    is_dir = entry->d_type == DT_DIR;
+    if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+#endif
+    {
+      struct stat file_info;
+      if (fstatat(dirfd(dir), name, &file_info, 0) == 0) {
+        is_file = S_ISREG(file_info.st_mode);
+#ifdef _DIRENT_HAVE_D_TYPE
+        is_dir = entry->d_type == DT_UNKNOWN && S_ISDIR(file_info.st_mode);
+#else
+        is_dir = S_ISDIR(file_info.st_mode);
+#endif
+      }
+    }
+
+    if (is_file && has_extension(name)) {
+      add_name(&files, name);
+    } else if (is_dir) {
+      add_name(&subdirs, name);
+    }
+  }
+  closedir(dir);
+
+  if (files.count > 1) {
+    qsort(files.names, files.count, sizeof(char*), compare_names);
+  }
+  for (int i = 0; i < files.count; i++) {
+    size_t len;
+    char* file = join_path(path, files.names[i], &len);
+    if (!file || input_list_add(walker->list, file, len, directory->source) != 0) {
+      fprintf(stderr, "Error: cannot add file '%s/%s'\n", path, files.names[i]);
+    }
+    free(file);
+  }
+
+  // Pushed backwards, so one thread reads them in order
+  if (subdirs.count > 1) {
+    qsort(subdirs.names, subdirs.count, sizeof(char*), compare_names);
+  }
+  pthread_mutex_lock(&walker->lock);
+  for (int i = subdirs.count - 1; i >= 0; i--) {
+    size_t len;
+    char* subdir = join_path(path, subdirs.names[i], &len);
+    if (!subdir || push_directory(walker, subdir, len, directory->source) != 0) {
+      fprintf(stderr, "Error: cannot read directory '%s/%s'\n", path, subdirs.names[i]);
+    }
+    free(subdir);
+  }
+  pthread_cond_broadcast(&walker->changed);
+  pthread_mutex_unlock(&walker->lock);
+
+  free_names(&files);
+  free_names(&subdirs);
+}
+
+static void* walker_main(void* arg) {
+  Walker* walker = (Walker*)arg;
+
+  pthread_mutex_lock(&walker->lock);
+  for (;;) {
+    while (walker->pending_count == 0 && walker->active > 0) {
+      pthread_cond_wait(&walker->changed, &walker->lock);
+    }
+    if (walker->pending_count == 0) {
+      break; // Nothing queued and nobody left to queue more
+    }
+
+    PendingDirectory directory = walker->pending[--walker->pending_count];
+    walker->active++;
+    pthread_mutex_unlock(&walker->lock);
+
+    read_directory(walker, &directory);
+    free(directory.path);
+
+    pthread_mutex_lock(&walker->lock);
+    walker->active--;
+    if (walker->active == 0) {
+      pthread_cond_broadcast(&walker->changed);
+    }
+  }
+
+  bool last = --walker->running == 0;
+  pthread_mutex_unlock(&walker->lock);
+
+  if (last) {
+    input_list_close(walker->list);
+  }
+  return NULL;
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+// NULL if the walk couldn't start, the list is left as it was
+Walker* walker_start(InputList* list, char** dirs, int dir_count, int threads) {
+  Walker* walker = calloc(1, sizeof(Walker));
+  if (!walker) return NULL;
+
+  walker->list = list;
+  walker->threads = malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+  pthread_mutex_init(&walker->lock, NULL);
+  pthread_cond_init(&walker->changed, NULL);
+
+  // Pushed backwards, so they are read in the order given
+  for (int i = dir_count - 1; i >= 0 && walker->threads; i--) {
+    if (push_directory(walker, dirs[i], strlen(dirs[i]), INPUT_FOUND(i)) != 0) {
+      free(walker->threads);
+      walker->threads = NULL;
+    }
+  }
+  if (!walker->threads) {
+    walker_join(walker);
+    return NULL;
+  }
+
+  input_list_open(list);
+  walker->running = threads > 0 ? threads : 1;
+
+  pthread_mutex_lock(&walker->lock);
+  for (int i = 0; i < walker->running; i++) {
+    if (pthread_create(&walker->threads[i], NULL, walker_main, walker) != 0) {
+      break;
+    }
+    walker->thread_count++;
+  }
+
+  // Threads that didn't start won't finish either
+  walker->running = walker->thread_count;
+  bool started = walker->thread_count > 0;
+  pthread_mutex_unlock(&walker->lock);
+
+  if (!started) {
+    input_list_close(list);
+    walker_join(walker);
+    return NULL;
+  }
+
+  return walker;
+}
+
+// Waits for the walk to end and frees the walker
+void walker_join(Walker* walker) {
+  if (!walker) return;
+
+  for (int i = 0; i < walker->thread_count; i++) {
+    pthread_join(walker->threads[i], NULL);
+  }
+
+  for (int i = 0; i < walker->pending_count; i++) {
+    free(walker->pending[i].path);
+  }
+  free(walker->pending);
+  free(walker->threads);
+  pthread_cond_destroy(&walker->changed);
+  pthread_mutex_destroy(&walker->lock);
+  free(walker);
+}
@@ -0,0 +1,433 @@
+/*
+ * pomointer - .pf file interpreter
+ * Copyright (c) 2026 José Isac Araujo Monção
+ * 
+ * See LICENSE file for full BSD 3-Clause license terms.
+ */
+#define _XOPEN_SOURCE 700 // For realpath and sigaction
+#include <stdio.h>
+#include "watch.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "hashmap.h"
+#include "util.h"
+
+// Editors either write files in place or replace them with a rename, so
+// directories are watched instead of the files themselves
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE)
+#define EVENT_BUFFER_SIZE (64 * 1024)
+
+/* ---------------------- AUXILIARY FUNCTIONS DECLARATIONS------------------------------- */
+
+// Files that read a path
+typedef struct {
+  int* files;
+  int count;
+  int capacity;
+} IndexList;
+
+// Paths a file was registered under
+typedef struct {
+  char** paths;
+  int count;
+} WatchedFile;
+
+typedef struct {
+  int fd;
+  HashMap* dirs;          // Directory -> watch descriptor + 1
+  char** dir_paths;       // Watch descriptor -> directory
+  int dir_capacity;
+  HashMap* dependents;    // Path -> IndexList*
+  WatchedFile* watched;
+  int* days;              // Day of each merged file
+  bool* dirty;
+  InputList* inputs;
+  int num_files;
+  ProcessData* process_data;
+} Watch;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handle_signal(int signal_number);
+static void absolute_path(const char* path, char* buffer, size_t size);
+static void watch_directory(Watch* watch, const char* path);
+static void add_dependent(Watch* watch, const char* path, int file);
+static void register_file(Watch* watch, int file);
+static void unregister_file(Watch* watch, int file);
+static void free_index_list(const char* key, void* value, void* user_data);
+static void update_duration(Watch* watch, int day);
+static void reparse_file(Watch* watch, int file);
+static bool read_events(Watch* watch);
+static void free_watch(Watch* watch);
+
+/* -----------------------------AUXILIARY FUNCTIONS ------------------------------- */
+
+static void handle_signal(int signal_number) {
+  (void)signal_number;
+  interrupted = 1;
+}
+
+// Resolved when the file exists, so it matches the paths of the reader stamps.
+// A relative path too long to join to the working directory stays as given.
+static void absolute_path(const char* path, char* buffer, size_t size) {
+  char resolved_path[PATH_MAX];
+  char cwd[PATH_MAX];
+
+  if (realpath(path, resolved_path) != NULL) {
+    snprintf(buffer, size, "%s", resolved_path);
+    return;
+  }
+
+  if (path[0] != '/' && getcwd(cwd, sizeof(cwd)) != NULL) {
+    int length = snprintf(buffer, size, "%s/%s", cwd, path);
+    if (length >= 0 && (size_t)length < size) return;
+  }
+
+  snprintf(buffer, size, "%s", path);
+}
+
+// Watches the directory holding path, once
+static void watch_directory(Watch* watch, const char* path) {
+  char dir[PATH_MAX];
+  extract_directory(path, dir, sizeof(dir));
+
+  if (hashmap_get(watch->dirs, dir) != NULL) {
+    return;
+  }
+
+  int wd = inotify_add_watch(watch->fd, dir, WATCH_MASK);
+  if (wd < 0) {
+    return; // Missing directory, nothing in it can change
+  }
+
+  if (wd >= watch->dir_capacity) {
+    int capacity = watch->dir_capacity > 0 ? watch->dir_capacity : 16;
+    while (capacity <= wd) {
+      capacity *= 2;
+    }
+
+    char** dir_paths = realloc(watch->dir_paths, sizeof(char*) * capacity);
+    if (dir_paths == NULL) return;
+
+    memset(dir_paths + watch->dir_capacity, 0, sizeof(char*) * (capacity - watch->dir_capacity));
+    watch->dir_paths = dir_paths;
+    watch->dir_capacity = capacity;
+  }
+
+  free(watch->dir_paths[wd]);
+  watch->dir_paths[wd] = string_from_view(NULL, dir, strlen(dir));
+  hashmap_put(watch->dirs, dir, (void*)(intptr_t)(wd + 1));
+}
+
+static void add_dependent(Watch* watch, const char* path, int file) {
+  IndexList* list = hashmap_get(watch->dependents, path);
+
+  if (list == NULL) {
+    list = calloc(1, sizeof(IndexList));
+    if (list == NULL) return;
+    hashmap_put(watch->dependents, path, list);
+  }
+
+  if (list->count == list->capacity) {
+    int capacity = list->capacity > 0 ? list->capacity * 2 : 4;
+    int* files = realloc(list->files, sizeof(int) * capacity);
+    if (files == NULL) return;
+
+    list->files = files;
+    list->capacity = capacity;
+  }
+
+  list->files[list->count++] = file;
+}
+
+// The file itself, plus whatever it read the last time it was parsed
+static void register_file(Watch* watch, int file) {
+  Input* input = input_list_get(watch->inputs, file);
+  PomoFile* pomofile = &input->pomofile;
+  WatchedFile* watched = &watch->watched[file];
+  char path[PATH_MAX];
+
+  watched->paths = malloc(sizeof(char*) * (pomofile->dependency_count + 1));
+  watched->count = 0;
+  if (watched->paths == NULL) return;
+
+  absolute_path(input->path, path, sizeof(path));
+  watched->paths[watched->count++] = string_from_view(NULL, path, strlen(path));
+
+  for (int i = 0; i < pomofile->dependency_count; i++) {
+    if (strcmp(pomofile->dependencies[i].path, path) != 0) {
+      const char* dependency = pomofile->dependencies[i].path;
+      watched->paths[watched->count++] = string_from_view(NULL, dependency, strlen(dependency));
+    }
+  }
+
+  for (int i = 0; i < watched->count; i++) {
+    if (watched->paths[i] == NULL) continue;
+
+    add_dependent(watch, watched->paths[i], file);
+    watch_directory(watch, watched->paths[i]);
+  }
+}
+
+static void unregister_file(Watch* watch, int file) {
+  WatchedFile* watched = &watch->watched[file];
+
+  for (int i = 0; i < watched->count; i++) {
+    if (watched->paths[i] == NULL) continue;
+
+    IndexList* list = hashmap_get(watch->dependents, watched->paths[i]);
+    for (int j = 0; list != NULL && j < list->count; j++) {
+      if (list->files[j] == file) {
+        list->files[j] = list->files[--list->count];
+        break;
+      }
+    }
+    free(watched->paths[i]);
+  }
+
+  free(watched->paths);
+  watched->paths = NULL;
+  watched->count = 0;
+}
+
+static void free_index_list(const char* key, void* value, void* user_data) {
+  IndexList* list = (IndexList*)value;
+  (void)key;
+  (void)user_data;
+
+  free(list->files);
+  free(list);
+}
+
+// A date takes the pomodoro duration of its last file, in input_order()
+static void update_duration(Watch* watch, int day) {
+  Input* last = NULL;
+
+  for (int i = 0; i < watch->num_files; i++) {
+    Input* input = input_list_get(watch->inputs, i);
+
+    if (input->result == 1 && !input->skipped && watch->days[i] == day &&
+        (last == NULL || input_order(last, input) < 0)) {
+      last = input;
+    }
+  }
+
+  if (last != NULL) {
+    pomofile_set_duration(watch->process_data, day, last->pomofile.pomodoro_duration);
+  }
+}
+
+// Replaces what a file added to the global registers with what it has now
+static void reparse_file(Watch* watch, int file) {
+  Input* input = input_list_get(watch->inputs, file);
+  PomoFile* pomofile = &input->pomofile;
+  ProcessData* process_data = watch->process_data;
+  bool was_merged = input->result == 1;
+  int old_day = watch->days[file];
+  const char* path = input->path;
+
+  // Included by other files, they are parsed again instead
+  if (input->skipped) {
+    return;
+  }
+
+  if (was_merged) {
+    pomofile_unmerge(pomofile, process_data->global_registers, process_data);
+  }
+
+  free_pomofile(pomofile);
+  input->result = -1;
+
+  if (pomofile_init(pomofile, path) == 0) {
+    input->result = pomofile_parse(pomofile, process_data);
+  }
+
+  if (input->result == 1) {
+    pomofile_merge(pomofile, process_data->global_registers, process_data);
+    watch->days[file] = pomofile->date;
+    update_duration(watch, watch->days[file]);
+  }
+
+  if (was_merged && (input->result != 1 || watch->days[file] != old_day)) {
+    update_duration(watch, old_day);
+  }
+
+  unregister_file(watch, file);
+  register_file(watch, file);
+}
+
+// Marks the files touched by the pending events. Returns false once
+// interrupted or if the events can't be read.
+static bool read_events(Watch* watch) {
+  union {
+    struct inotify_event event; // For its alignment
+    char bytes[EVENT_BUFFER_SIZE];
+  } buffer;
+
+  for (;;) {
+    struct pollfd pfd = {watch->fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, 0);
+    if (ready <= 0) {
+      return ready == 0 || (errno == EINTR && !interrupted);
+    }
+
+    ssize_t length = read(watch->fd, buffer.bytes, sizeof(buffer.bytes));
+    if (length <= 0) {
+      return length < 0 && errno == EINTR && !interrupted;
+    }
+
+    for (char* p = buffer.bytes; p < buffer.bytes + length; ) {
+      struct inotify_event* event = (struct inotify_event*)p;
+      p += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        memset(watch->dirty, true, sizeof(bool) * watch->num_files);
+        continue;
+      }
+      if (event->wd < 0 || event->wd >= watch->dir_capacity || watch->dir_paths[event->wd] == NULL) {
+        continue;
+      }
+
+      const char* dir = watch->dir_paths[event->wd];
+      if (event->mask & IN_IGNORED) {
+        hashmap_remove(watch->dirs, dir, NULL);
+        free(watch->dir_paths[event->wd]);
+        watch->dir_paths[event->wd] = NULL;
+        continue;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+
+      // Watched paths fit in PATH_MAX, a longer one isn't among them
+      char path[PATH_MAX];
+      int length = snprintf(path, sizeof(path), "%s/%s", dir, event->name);
+      if (length < 0 || (size_t)length >= sizeof(path)) {
+        continue;
+      }
+
+      IndexList* list = hashmap_get(watch->dependents, path);
+      for (int i = 0; list != NULL && i < list->count; i++) {
+        watch->dirty[list->files[i]] = true;
+      }
+    }
+  }
+}
+
+static void free_watch(Watch* watch) {
+  if (watch->fd >= 0) {
+    close(watch->fd);
+  }
+
+  for (int i = 0; watch->watched && i < watch->num_files; i++) {
+    unregister_file(watch, i);
+  }
+  for (int i = 0; i < watch->dir_capacity; i++) {
+    free(watch->dir_paths[i]);
+  }
+
+  if (watch->dependents) {
+    hashmap_foreach(watch->dependents, free_index_list, NULL);
+    hashmap_destroy(watch->dependents, NULL);
+  }
+  hashmap_destroy(watch->dirs, NULL);
+  free(watch->dir_paths);
+  free(watch->watched);
+  free(watch->days);
+  free(watch->dirty);
+}
+
+/* ---------------------- AUXILIARY FUNCTIONS END ------------------------------- */
+
+int watch_run(InputList* inputs, ProcessData* process_data, void (*report)(void)) {
+  int num_files = input_list_count(inputs);
+  Watch watch;
+  memset(&watch, 0, sizeof(watch));
+  watch.inputs = inputs;
+  watch.num_files = num_files;
+  watch.process_data = process_data;
+
+  watch.fd = inotify_init1(IN_CLOEXEC);
+  watch.dirs = hashmap_create(64, 0.75);
+  watch.dependents = hashmap_create(num_files * 2, 0.75);
+  watch.watched = calloc(num_files, sizeof(WatchedFile));
+  watch.days = malloc(sizeof(int) * num_files);
+  watch.dirty = calloc(num_files, sizeof(bool));
+
+  if (watch.fd < 0 || !watch.dirs || !watch.dependents || !watch.watched || !watch.days || !watch.dirty) {
+    fprintf(stderr, "Error: cannot watch the input files\n");
+    free_watch(&watch);
+    return -1;
+  }
+
+  for (int i = 0; i < num_files; i++) {
+    Input* input = input_list_get(inputs, i);
+    watch.days[i] = input->result == 1 ? input->pomofile.date : 0;
+    register_file(&watch, i);
+  }
+
+  // Stop cleanly, so whoever called us can save and free everything
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  while (!interrupted) {
+    struct pollfd pfd = {watch.fd, POLLIN, 0};
+    if (poll(&pfd, 1, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (!read_events(&watch)) {
+      break;
+    }
+
+    // Changed includes are read again, with whatever includes them
+    if (process_data->include_cache != NULL && include_cache_revalidate(process_data->include_cache) != 0) {
+      fprintf(stderr, "Error: cannot read the changed files again\n");
+      break;
+    }
+
+    bool changed = false;
+    for (int i = 0; i < num_files; i++) {
+      if (watch.dirty[i]) {
+        watch.dirty[i] = false;
+        reparse_file(&watch, i);
+        changed = true;
+      }
+    }
+
+    if (changed) {
+      report();
+    }
+  }
+
+  free_watch(&watch);
+  return 0;
+}
+
+#else
+
+int watch_run(InputList* inputs, ProcessData* process_data, void (*report)(void)) {
+  (void)inputs;
+  (void)process_data;
+  (void)report;
+
+  fprintf(stderr, "Error: watching files needs inotify, only available on Linux\n");
+  return -1;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# pomointer - .pf file interpreter
+# Copyright (c) 2026 José Isac Araujo Monção
+#
+# See LICENSE file for full BSD 3-Clause license terms.
+#
+# Checks how -a and -b skip files whose DATE is out of range, for a file
+# that sets DATE again after its first task. Without -a and -b the last
+# DATE counts. With them, the DATE before the first task decides, unless no
+# date is in range at all or -w reads the files. Fails on the first case
+# whose CSV output isn't the expected one.
+
+BIN=$(pwd)/build/pomointer
+DIR=$(mktemp -d "${TMPDIR:-/tmp}/pomointer-test.XXXXXX") || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+printf 'DATE = 01/01/2020\nPOMO = 25\n\nMath: ***\nDATE = 05/05/2026\nPhys: **\n' > late.pf
+printf 'DATE = 06/05/2026\nPOMO = 25\n\nChem: *\n' > in_range.pf
+
+LATE='05/05/2026,Math,3,75
+05/05/2026,Phys,2,50'
+IN_RANGE='06/05/2026,Chem,1,25'
+failed=0
+
+check() {
+  name=$1
+  expected=$2
+  shift 2
+
+  output=$("$@" 2>&1 | sed 1d)
+  if [ "$output" != "$expected" ]; then
+    printf 'FAIL %s\nexpected:\n%s\ngot:\n%s\n' "$name" "$expected" "$output"
+    failed=1
+  else
+    echo "ok   $name"
+  fi
+}
+
+check "last DATE counts" "$LATE
+$IN_RANGE" "$BIN" -e csv late.pf in_range.pf
+
+check "first DATE out of range skips the file" "$IN_RANGE" \
+  "$BIN" -e csv -a 01/05/2026 late.pf in_range.pf
+
+check "nothing in range reads it whole" "$LATE" \
+  "$BIN" -e csv -b 01/01/2000 late.pf
+
+# The first report, -w keeps watching until timeout stops it
+check "-w reads it whole" "$LATE
+$IN_RANGE" timeout 1 "$BIN" -e csv -w -a 01/05/2026 late.pf in_range.pf
+
+exit $failed